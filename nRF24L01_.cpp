@@ -11,3 +11,35 @@
 
 #include "nRF24L01_.hpp"
 
+#define NRF24L01_REGISTER(R, clear) \
+	{ #R, R::__address, R::__width, R::__dflt, (uint8_t)R::__reserved, (uint8_t)R::__readonly, clear }
+
+const nRF24L01_Base::RegisterInfo nRF24L01_Base::REGISTERS[nRF24L01_Base::REGISTER_COUNT] =
+{
+	NRF24L01_REGISTER(CONFIG, 0),
+	NRF24L01_REGISTER(EN_AA, 0),
+	NRF24L01_REGISTER(EN_RXADDR, 0),
+	NRF24L01_REGISTER(SETUP_AW, 0),
+	NRF24L01_REGISTER(SETUP_RETR, 0),
+	NRF24L01_REGISTER(RF_CH, 0),
+	NRF24L01_REGISTER(RF_SETUP, 0),
+	NRF24L01_REGISTER(STATUS, STATUS::__clear),
+	NRF24L01_REGISTER(OBSERVE_TX, 0),
+	NRF24L01_REGISTER(RPD, 0),
+	NRF24L01_REGISTER(RX_ADDR_P0, 0),
+	NRF24L01_REGISTER(RX_ADDR_P1, 0),
+	NRF24L01_REGISTER(RX_ADDR_P2, 0),
+	NRF24L01_REGISTER(RX_ADDR_P3, 0),
+	NRF24L01_REGISTER(RX_ADDR_P4, 0),
+	NRF24L01_REGISTER(RX_ADDR_P5, 0),
+	NRF24L01_REGISTER(TX_ADDR, 0),
+	NRF24L01_REGISTER(RX_PW_P0, 0),
+	NRF24L01_REGISTER(RX_PW_P1, 0),
+	NRF24L01_REGISTER(RX_PW_P2, 0),
+	NRF24L01_REGISTER(RX_PW_P3, 0),
+	NRF24L01_REGISTER(RX_PW_P4, 0),
+	NRF24L01_REGISTER(RX_PW_P5, 0),
+	NRF24L01_REGISTER(FIFO_STATUS, 0),
+	NRF24L01_REGISTER(DYNPD, 0),
+	NRF24L01_REGISTER(FEATURE, 0),
+};
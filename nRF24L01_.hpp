@@ -9,9 +9,128 @@
  * file:        nRF24L01_.hpp
  */
 
+#ifndef NRF24L01__HPP
+#define NRF24L01__HPP
+
 #include <cinttypes>
 
-/* Derive from class nRF24L01_Base and implement the read and write functions! */
+#ifdef NRF24L01_INSTRUMENT
+#include <cstring>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <time.h>
+#endif
+
+/* Cycle counter, ns on platforms without one */
+inline uint64_t nRF24L01_cycles()
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#elif defined(__aarch64__)
+	uint64_t v;
+	__asm__ __volatile__("mrs %0, cntvct_el0" : "=r"(v));
+	return v;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+#endif
+}
+
+/*
+ * Log-linear latency histogram (HDR style): 2^SUB_BITS linear buckets per
+ * power of two, so the relative error is below 1/2^SUB_BITS. Fixed size,
+ * add() does not allocate.
+ */
+struct nRF24L01_Histogram
+{
+	static const unsigned SUB_BITS = 3;
+	static const unsigned SUB = 1u << SUB_BITS;
+	static const unsigned BUCKETS = (64 - SUB_BITS + 1) * SUB;
+
+	uint32_t bucket[BUCKETS];
+	uint64_t count, sum, max;
+
+	nRF24L01_Histogram() { reset(); }
+
+	void reset()
+	{
+		std::memset(this, 0, sizeof(*this));
+	}
+
+	static unsigned index(uint64_t v)
+	{
+		if (v < SUB)
+			return (unsigned)v;
+		unsigned exponent = 63 - __builtin_clzll(v) - SUB_BITS + 1;
+		return exponent * SUB + (unsigned)((v >> (exponent - 1)) & (SUB - 1));
+	}
+
+	/* Lowest value that maps to bucket i */
+	static uint64_t lowest(unsigned i)
+	{
+		unsigned exponent = i / SUB;
+		if (!exponent)
+			return i;
+		return (uint64_t)(SUB | (i % SUB)) << (exponent - 1);
+	}
+
+	void add(uint64_t v)
+	{
+		bucket[index(v)]++;
+		count++;
+		sum += v;
+		if (v > max)
+			max = v;
+	}
+
+	/* Value at percentile p (0..100) */
+	uint64_t percentile(double p) const
+	{
+		uint64_t target = (uint64_t)(count * p / 100.0 + 0.5), seen = 0;
+		for (unsigned i = 0; i < BUCKETS; i++)
+		{
+			seen += bucket[i];
+			if (seen >= target && seen)
+				return lowest(i);
+		}
+		return max;
+	}
+};
+
+/* Adds the cycles spent in its scope to a histogram */
+struct nRF24L01_Probe
+{
+	nRF24L01_Histogram &h;
+	uint64_t start;
+
+	nRF24L01_Probe(nRF24L01_Histogram &h) : h(h), start(nRF24L01_cycles()) {}
+	~nRF24L01_Probe() { h.add(nRF24L01_cycles() - start); }
+};
+
+#define NRF24L01_PROBE(op) nRF24L01_Probe nRF24L01_probe(stats.op)
+#define NRF24L01_STATUS(value) instrumentStatus(value)
+#else
+#define NRF24L01_PROBE(op)
+#define NRF24L01_STATUS(value)
+#endif
+
+/* Compile time assertion, fails to compile with an incomplete type if cond is false */
+template<bool cond> struct nRF24L01_StaticAssert;
+template<> struct nRF24L01_StaticAssert<true> {};
+#define NRF24L01_STATIC_ASSERT(cond) ((void)sizeof(nRF24L01_StaticAssert<(cond)>))
+
+/* value is true if A and B are the same type */
+template<class A, class B> struct nRF24L01_SameType { static const bool value = false; };
+template<class A> struct nRF24L01_SameType<A, A> { static const bool value = true; };
+
+template<class R> class nRF24L01_Value;
+
+/* Receive handler, called for every payload read from the RX FIFO */
+typedef void (*nRF24L01_ReceiveHandler)(void *context, uint8_t pipe, const uint8_t *data, uint8_t n);
+
+/* Derive from class nRF24L01_Base and implement the read, write and command functions! */
 
 /* nRF24L01+: Single Chip 2.4GHz Transceiver */
 class nRF24L01_Base
@@ -22,6 +141,45 @@ public:
 	virtual void write(uint16_t address, uint8_t value, uint16_t n=8) = 0;  // 8 bit write
 	virtual uint64_t read64(uint16_t address, uint16_t n=64) = 0;  // 64 bit read
 	virtual void write(uint16_t address, uint64_t value, uint16_t n=64) = 0;  // 64 bit write
+	virtual uint8_t command(uint8_t cmd, const uint8_t *tx, uint8_t *rx, uint16_t n) = 0;  // SPI command, returns STATUS
+	
+	/* Optional functions, override in derived class where the platform provides them: */
+	virtual void ce(bool level) { (void)level; }  // drive the CE pin
+	virtual void delayUs(uint32_t us) { (void)us; }  // busy wait
+	virtual uint8_t readDynamicPayload(uint8_t *buffer);  // payload of R_RX_PL_WID bytes, override to use one transaction
+	
+	nRF24L01_Base() : seed(0) {}
+	virtual ~nRF24L01_Base() {}
+	
+#ifdef NRF24L01_INSTRUMENT
+	/* Per operation latency in cycles, build with -DNRF24L01_INSTRUMENT */
+	struct Stats
+	{
+		nRF24L01_Histogram read8, write8, read64, write64, command;
+		nRF24L01_Histogram irqToRx;  // markIrq() to the next RX payload read
+		nRF24L01_Histogram txToDone;  // TX payload load to TX_DS seen in STATUS
+		uint64_t irqAt, txAt;  // 0 if no interval is open
+		
+		Stats() : irqAt(0), txAt(0) {}
+	} stats;
+	
+	/* Call first thing in the IRQ handler */
+	void markIrq()
+	{
+		stats.irqAt = nRF24L01_cycles();
+	}
+	
+	void instrumentStatus(uint8_t status)
+	{
+		if (stats.txAt && (status & STATUS::TX_DS::mask))
+		{
+			stats.txToDone.add(nRF24L01_cycles() - stats.txAt);
+			stats.txAt = 0;
+		}
+	}
+#else
+	void markIrq() {}
+#endif
 	
 	
 	/*****************************************************************************************************\
@@ -37,11 +195,16 @@ public:
 	struct CONFIG
 	{
 		static const uint16_t __address = 0;
+		static const uint16_t __width = 8;
+		static const uint8_t __dflt = 0b00001000;
+		static const uint8_t __reserved = 0b10000000;
+		static const uint8_t __readonly = 0b00000000;
 		
 		/* Bits Reserved_0: */
 		/* Only '0' allowed  */
 		struct Reserved_0
 		{
+			typedef CONFIG Register;
 			static const uint8_t dflt = 0b0; // 1'b0
 			static const uint8_t mask = 0b10000000; // [7]
 		};
@@ -54,6 +217,7 @@ public:
 		 */
 		struct MASK_RX_DR
 		{
+			typedef CONFIG Register;
 			static const uint8_t dflt = 0b0; // 1'b0
 			static const uint8_t mask = 0b01000000; // [6]
 		};
@@ -66,6 +230,7 @@ public:
 		 */
 		struct MASK_TX_DS
 		{
+			typedef CONFIG Register;
 			static const uint8_t dflt = 0b0; // 1'b0
 			static const uint8_t mask = 0b00100000; // [5]
 		};
@@ -78,6 +243,7 @@ public:
 		 */
 		struct MASK_MAX_RT
 		{
+			typedef CONFIG Register;
 			static const uint8_t dflt = 0b0; // 1'b0
 			static const uint8_t mask = 0b00010000; // [4]
 		};
@@ -88,6 +254,7 @@ public:
 		 */
 		struct EN_CRC
 		{
+			typedef CONFIG Register;
 			static const uint8_t dflt = 0b1; // 1'b1
 			static const uint8_t mask = 0b00001000; // [3]
 		};
@@ -95,6 +262,7 @@ public:
 		/* CRC encoding scheme  */
 		struct CRCO
 		{
+			typedef CONFIG Register;
 			static const uint8_t dflt = 0b0; // 1'b0
 			static const uint8_t mask = 0b00000100; // [2]
 			static const uint8_t CRC_1_BYTE = 0b0; // 1 byte
@@ -104,6 +272,7 @@ public:
 		/* 1: POWER UP, 0:POWER DOWN  */
 		struct PWR_UP
 		{
+			typedef CONFIG Register;
 			static const uint8_t dflt = 0b0; // 1'b0
 			static const uint8_t mask = 0b00000010; // [1]
 			static const uint8_t POWER_UP = 0b1; // 
@@ -116,6 +285,7 @@ public:
 		 */
 		struct PRIM_RX
 		{
+			typedef CONFIG Register;
 			static const uint8_t dflt = 0b0; // 1'b0
 			static const uint8_t mask = 0b00000001; // [0]
 			static const uint8_t PRX = 0b1; // 
@@ -126,12 +296,14 @@ public:
 	/* Set register CONFIG */
 	void setCONFIG(uint8_t value)
 	{
+		NRF24L01_PROBE(write8);
 		write(CONFIG::__address, value, 8);
 	}
 	
 	/* Get register CONFIG */
 	uint8_t getCONFIG()
 	{
+		NRF24L01_PROBE(read8);
 		return read8(CONFIG::__address, 8);
 	}
 	
@@ -151,11 +323,16 @@ public:
 	struct EN_AA
 	{
 		static const uint16_t __address = 1;
+		static const uint16_t __width = 8;
+		static const uint8_t __dflt = 0b00111111;
+		static const uint8_t __reserved = 0b11000000;
+		static const uint8_t __readonly = 0b00000000;
 		
 		/* Bits Reserved_0: */
 		/* Only '00' allowed  */
 		struct Reserved_0
 		{
+			typedef EN_AA Register;
 			static const uint8_t dflt = 0b00; // 2'b0
 			static const uint8_t mask = 0b11000000; // [6,7]
 		};
@@ -163,6 +340,7 @@ public:
 		/* Enable auto acknowledgement data pipe 5  */
 		struct ENAA_P5
 		{
+			typedef EN_AA Register;
 			static const uint8_t dflt = 0b1; // 1'b1
 			static const uint8_t mask = 0b00100000; // [5]
 		};
@@ -170,6 +348,7 @@ public:
 		/* Enable auto acknowledgement data pipe 4  */
 		struct ENAA_P4
 		{
+			typedef EN_AA Register;
 			static const uint8_t dflt = 0b1; // 1'b1
 			static const uint8_t mask = 0b00010000; // [4]
 		};
@@ -177,6 +356,7 @@ public:
 		/* Enable auto acknowledgement data pipe 3  */
 		struct ENAA_P3
 		{
+			typedef EN_AA Register;
 			static const uint8_t dflt = 0b1; // 1'b1
 			static const uint8_t mask = 0b00001000; // [3]
 		};
@@ -184,6 +364,7 @@ public:
 		/* Enable auto acknowledgement data pipe 2  */
 		struct ENAA_P2
 		{
+			typedef EN_AA Register;
 			static const uint8_t dflt = 0b1; // 1'b1
 			static const uint8_t mask = 0b00000100; // [2]
 		};
@@ -191,6 +372,7 @@ public:
 		/* Enable auto acknowledgement data pipe 1  */
 		struct ENAA_P1
 		{
+			typedef EN_AA Register;
 			static const uint8_t dflt = 0b1; // 1'b1
 			static const uint8_t mask = 0b00000010; // [1]
 		};
@@ -198,6 +380,7 @@ public:
 		/* Enable auto acknowledgement data pipe 0  */
 		struct ENAA_P0
 		{
+			typedef EN_AA Register;
 			static const uint8_t dflt = 0b1; // 1'b1
 			static const uint8_t mask = 0b00000001; // [0]
 		};
@@ -206,12 +389,14 @@ public:
 	/* Set register EN_AA */
 	void setEN_AA(uint8_t value)
 	{
+		NRF24L01_PROBE(write8);
 		write(EN_AA::__address, value, 8);
 	}
 	
 	/* Get register EN_AA */
 	uint8_t getEN_AA()
 	{
+		NRF24L01_PROBE(read8);
 		return read8(EN_AA::__address, 8);
 	}
 	
@@ -229,11 +414,16 @@ public:
 	struct EN_RXADDR
 	{
 		static const uint16_t __address = 2;
+		static const uint16_t __width = 8;
+		static const uint8_t __dflt = 0b00000011;
+		static const uint8_t __reserved = 0b11000000;
+		static const uint8_t __readonly = 0b00000000;
 		
 		/* Bits Reserved_0: */
 		/* Only '00' allowed  */
 		struct Reserved_0
 		{
+			typedef EN_RXADDR Register;
 			static const uint8_t dflt = 0b00; // 2'b0
 			static const uint8_t mask = 0b11000000; // [6,7]
 		};
@@ -241,6 +431,7 @@ public:
 		/* Enable data pipe 5.  */
 		struct ERX_P5
 		{
+			typedef EN_RXADDR Register;
 			static const uint8_t dflt = 0b0; // 1'b0
 			static const uint8_t mask = 0b00100000; // [5]
 		};
@@ -248,6 +439,7 @@ public:
 		/* Enable data pipe 4.  */
 		struct ERX_P4
 		{
+			typedef EN_RXADDR Register;
 			static const uint8_t dflt = 0b0; // 1'b0
 			static const uint8_t mask = 0b00010000; // [4]
 		};
@@ -255,6 +447,7 @@ public:
 		/* Enable data pipe 3.  */
 		struct ERX_P3
 		{
+			typedef EN_RXADDR Register;
 			static const uint8_t dflt = 0b0; // 1'b0
 			static const uint8_t mask = 0b00001000; // [3]
 		};
@@ -262,6 +455,7 @@ public:
 		/* Enable data pipe 2.  */
 		struct ERX_P2
 		{
+			typedef EN_RXADDR Register;
 			static const uint8_t dflt = 0b0; // 1'b0
 			static const uint8_t mask = 0b00000100; // [2]
 		};
@@ -269,6 +463,7 @@ public:
 		/* Enable data pipe 1.  */
 		struct ERX_P1
 		{
+			typedef EN_RXADDR Register;
 			static const uint8_t dflt = 0b1; // 1'b1
 			static const uint8_t mask = 0b00000010; // [1]
 		};
@@ -276,6 +471,7 @@ public:
 		/* Enable data pipe 0.  */
 		struct ERX_P0
 		{
+			typedef EN_RXADDR Register;
 			static const uint8_t dflt = 0b1; // 1'b1
 			static const uint8_t mask = 0b00000001; // [0]
 		};
@@ -284,12 +480,14 @@ public:
 	/* Set register EN_RXADDR */
 	void setEN_RXADDR(uint8_t value)
 	{
+		NRF24L01_PROBE(write8);
 		write(EN_RXADDR::__address, value, 8);
 	}
 	
 	/* Get register EN_RXADDR */
 	uint8_t getEN_RXADDR()
 	{
+		NRF24L01_PROBE(read8);
 		return read8(EN_RXADDR::__address, 8);
 	}
 	
@@ -308,11 +506,16 @@ public:
 	struct SETUP_AW
 	{
 		static const uint16_t __address = 3;
+		static const uint16_t __width = 8;
+		static const uint8_t __dflt = 0b00000011;
+		static const uint8_t __reserved = 0b11111100;
+		static const uint8_t __readonly = 0b00000000;
 		
 		/* Bits Reserved_0: */
 		/* Only '000000' allowed  */
 		struct Reserved_0
 		{
+			typedef SETUP_AW Register;
 			static const uint8_t dflt = 0b000000; // 6'b0
 			static const uint8_t mask = 0b11111100; // [2,3,4,5,6,7]
 		};
@@ -327,6 +530,7 @@ public:
 		 */
 		struct AW
 		{
+			typedef SETUP_AW Register;
 			static const uint8_t dflt = 0b11; // 2'b11
 			static const uint8_t mask = 0b00000011; // [0,1]
 			static const uint8_t ILLEGAL = 0b00; // 
@@ -339,12 +543,14 @@ public:
 	/* Set register SETUP_AW */
 	void setSETUP_AW(uint8_t value)
 	{
+		NRF24L01_PROBE(write8);
 		write(SETUP_AW::__address, value, 8);
 	}
 	
 	/* Get register SETUP_AW */
 	uint8_t getSETUP_AW()
 	{
+		NRF24L01_PROBE(read8);
 		return read8(SETUP_AW::__address, 8);
 	}
 	
@@ -362,6 +568,10 @@ public:
 	struct SETUP_RETR
 	{
 		static const uint16_t __address = 4;
+		static const uint16_t __width = 8;
+		static const uint8_t __dflt = 0b00000011;
+		static const uint8_t __reserved = 0b00000000;
+		static const uint8_t __readonly = 0b00000000;
 		
 		/* Bits ARDa: */
 		/*
@@ -376,6 +586,7 @@ public:
 		 */
 		struct ARDa
 		{
+			typedef SETUP_RETR Register;
 			static const uint8_t dflt = 0b0000; // 4'b0
 			static const uint8_t mask = 0b11110000; // [4,5,6,7]
 		};
@@ -389,6 +600,7 @@ public:
 		 */
 		struct ARC
 		{
+			typedef SETUP_RETR Register;
 			static const uint8_t dflt = 0b0011; // 4'b11
 			static const uint8_t mask = 0b00001111; // [0,1,2,3]
 		};
@@ -397,12 +609,14 @@ public:
 	/* Set register SETUP_RETR */
 	void setSETUP_RETR(uint8_t value)
 	{
+		NRF24L01_PROBE(write8);
 		write(SETUP_RETR::__address, value, 8);
 	}
 	
 	/* Get register SETUP_RETR */
 	uint8_t getSETUP_RETR()
 	{
+		NRF24L01_PROBE(read8);
 		return read8(SETUP_RETR::__address, 8);
 	}
 	
@@ -420,11 +634,16 @@ public:
 	struct RF_CH
 	{
 		static const uint16_t __address = 5;
+		static const uint16_t __width = 8;
+		static const uint8_t __dflt = 0b00000010;
+		static const uint8_t __reserved = 0b10000000;
+		static const uint8_t __readonly = 0b00000000;
 		
 		/* Bits Reserved_0: */
 		/* Only '0' allowed  */
 		struct Reserved_0
 		{
+			typedef RF_CH Register;
 			static const uint8_t dflt = 0b0; // 1'b0
 			static const uint8_t mask = 0b10000000; // [7]
 		};
@@ -432,6 +651,7 @@ public:
 		/* Sets the frequency channel nRF24L01+ operates on  */
 		struct RF_CH_
 		{
+			typedef RF_CH Register;
 			static const uint8_t dflt = 0b0000010; // 7'b10
 			static const uint8_t mask = 0b01111111; // [0,1,2,3,4,5,6]
 		};
@@ -440,12 +660,14 @@ public:
 	/* Set register RF_CH */
 	void setRF_CH(uint8_t value)
 	{
+		NRF24L01_PROBE(write8);
 		write(RF_CH::__address, value, 8);
 	}
 	
 	/* Get register RF_CH */
 	uint8_t getRF_CH()
 	{
+		NRF24L01_PROBE(read8);
 		return read8(RF_CH::__address, 8);
 	}
 	
@@ -463,11 +685,16 @@ public:
 	struct RF_SETUP
 	{
 		static const uint16_t __address = 6;
+		static const uint16_t __width = 8;
+		static const uint8_t __dflt = 0b00001110;
+		static const uint8_t __reserved = 0b01000000;
+		static const uint8_t __readonly = 0b00000000;
 		
 		/* Bits CONT_WAVE: */
 		/* Enables continuous carrier transmit when high.  */
 		struct CONT_WAVE
 		{
+			typedef RF_SETUP Register;
 			static const uint8_t dflt = 0b0; // 1'b0
 			static const uint8_t mask = 0b10000000; // [7]
 		};
@@ -475,6 +702,7 @@ public:
 		/* Only '0' allowed  */
 		struct Reserved_0
 		{
+			typedef RF_SETUP Register;
 			static const uint8_t dflt = 0b0; // 1'b0
 			static const uint8_t mask = 0b01000000; // [6]
 		};
@@ -485,6 +713,7 @@ public:
 		 */
 		struct RF_DR_LOW
 		{
+			typedef RF_SETUP Register;
 			static const uint8_t dflt = 0b0; // 1'b0
 			static const uint8_t mask = 0b00100000; // [5]
 		};
@@ -492,6 +721,7 @@ public:
 		/* Force PLL lock signal. Only used in test  */
 		struct PLL_LOCK
 		{
+			typedef RF_SETUP Register;
 			static const uint8_t dflt = 0b0; // 1'b0
 			static const uint8_t mask = 0b00010000; // [4]
 		};
@@ -508,6 +738,7 @@ public:
 		 */
 		struct RF_DR_HIGH
 		{
+			typedef RF_SETUP Register;
 			static const uint8_t dflt = 0b1; // 1'b1
 			static const uint8_t mask = 0b00001000; // [3]
 		};
@@ -515,6 +746,7 @@ public:
 		/* Set RF output power in TX mode  */
 		struct RF_PWR
 		{
+			typedef RF_SETUP Register;
 			static const uint8_t dflt = 0b11; // 2'b11
 			static const uint8_t mask = 0b00000110; // [1,2]
 			static const uint8_t TX_MINUS18dBm = 0b00; // -18dBm
@@ -526,6 +758,7 @@ public:
 		/* Don't care */
 		struct Obsolete
 		{
+			typedef RF_SETUP Register;
 			static const uint8_t mask = 0b00000001; // [0]
 		};
 	};
@@ -533,12 +766,14 @@ public:
 	/* Set register RF_SETUP */
 	void setRF_SETUP(uint8_t value)
 	{
+		NRF24L01_PROBE(write8);
 		write(RF_SETUP::__address, value, 8);
 	}
 	
 	/* Get register RF_SETUP */
 	uint8_t getRF_SETUP()
 	{
+		NRF24L01_PROBE(read8);
 		return read8(RF_SETUP::__address, 8);
 	}
 	
@@ -558,11 +793,17 @@ public:
 	struct STATUS
 	{
 		static const uint16_t __address = 7;
+		static const uint16_t __width = 8;
+		static const uint8_t __dflt = 0b00001110;
+		static const uint8_t __reserved = 0b10000000;
+		static const uint8_t __readonly = 0b00001111;
+		static const uint8_t __clear = 0b01110000; // write 1 to clear
 		
 		/* Bits Reserved_0: */
 		/* Only '0' allowed  */
 		struct Reserved_0
 		{
+			typedef STATUS Register;
 			/* Mode:rw */
 			static const uint8_t dflt = 0b0; // 1'b0
 			static const uint8_t mask = 0b10000000; // [7]
@@ -575,6 +816,7 @@ public:
 		 */
 		struct RX_DR
 		{
+			typedef STATUS Register;
 			/* Mode:rw */
 			static const uint8_t dflt = 0b0; // 1'b0
 			static const uint8_t mask = 0b01000000; // [6]
@@ -589,6 +831,7 @@ public:
 		 */
 		struct TX_DS
 		{
+			typedef STATUS Register;
 			/* Mode:rw */
 			static const uint8_t dflt = 0b0; // 1'b0
 			static const uint8_t mask = 0b00100000; // [5]
@@ -602,6 +845,7 @@ public:
 		 */
 		struct MAX_RT
 		{
+			typedef STATUS Register;
 			/* Mode:rw */
 			static const uint8_t dflt = 0b0; // 1'b0
 			static const uint8_t mask = 0b00010000; // [4]
@@ -617,6 +861,7 @@ public:
 		 */
 		struct RX_P_NO
 		{
+			typedef STATUS Register;
 			/* Mode:r */
 			static const uint8_t dflt = 0b111; // 3'b111
 			static const uint8_t mask = 0b00001110; // [1,2,3]
@@ -631,6 +876,7 @@ public:
 		 */
 		struct TX_FULL
 		{
+			typedef STATUS Register;
 			/* Mode:r */
 			static const uint8_t dflt = 0b0; // 1'b0
 			static const uint8_t mask = 0b00000001; // [0]
@@ -641,13 +887,17 @@ public:
 	/* Set register STATUS */
 	void setSTATUS(uint8_t value)
 	{
+		NRF24L01_PROBE(write8);
 		write(STATUS::__address, value, 8);
 	}
 	
 	/* Get register STATUS */
 	uint8_t getSTATUS()
 	{
-		return read8(STATUS::__address, 8);
+		NRF24L01_PROBE(read8);
+		uint8_t value = read8(STATUS::__address, 8);
+		NRF24L01_STATUS(value);
+		return value;
 	}
 	
 	
@@ -664,6 +914,10 @@ public:
 	struct OBSERVE_TX
 	{
 		static const uint16_t __address = 8;
+		static const uint16_t __width = 8;
+		static const uint8_t __dflt = 0b00000000;
+		static const uint8_t __reserved = 0b00000000;
+		static const uint8_t __readonly = 0b11111111;
 		
 		/* Bits PLOS_CNT: */
 		/*
@@ -674,6 +928,7 @@ public:
 		 */
 		struct PLOS_CNT
 		{
+			typedef OBSERVE_TX Register;
 			static const uint8_t dflt = 0b0000; // 4'b0
 			static const uint8_t mask = 0b11110000; // [4,5,6,7]
 		};
@@ -685,6 +940,7 @@ public:
 		 */
 		struct ARC_CNT
 		{
+			typedef OBSERVE_TX Register;
 			static const uint8_t dflt = 0b0000; // 4'b0
 			static const uint8_t mask = 0b00001111; // [0,1,2,3]
 		};
@@ -693,12 +949,14 @@ public:
 	/* Set register OBSERVE_TX */
 	void setOBSERVE_TX(uint8_t value)
 	{
+		NRF24L01_PROBE(write8);
 		write(OBSERVE_TX::__address, value, 8);
 	}
 	
 	/* Get register OBSERVE_TX */
 	uint8_t getOBSERVE_TX()
 	{
+		NRF24L01_PROBE(read8);
 		return read8(OBSERVE_TX::__address, 8);
 	}
 	
@@ -714,10 +972,15 @@ public:
 	struct RPD
 	{
 		static const uint16_t __address = 9;
+		static const uint16_t __width = 8;
+		static const uint8_t __dflt = 0b00000000;
+		static const uint8_t __reserved = 0b11111110;
+		static const uint8_t __readonly = 0b00000001;
 		
 		/* Bits Reserved_0: */
 		struct Reserved_0
 		{
+			typedef RPD Register;
 			static const uint8_t dflt = 0b0000000; // 7'b0
 			static const uint8_t mask = 0b11111110; // [1,2,3,4,5,6,7]
 		};
@@ -731,6 +994,7 @@ public:
 		 */
 		struct RPD_
 		{
+			typedef RPD Register;
 			static const uint8_t dflt = 0b0; // 1'b0
 			static const uint8_t mask = 0b00000001; // [0]
 		};
@@ -739,12 +1003,14 @@ public:
 	/* Set register RPD */
 	void setRPD(uint8_t value)
 	{
+		NRF24L01_PROBE(write8);
 		write(RPD::__address, value, 8);
 	}
 	
 	/* Get register RPD */
 	uint8_t getRPD()
 	{
+		NRF24L01_PROBE(read8);
 		return read8(RPD::__address, 8);
 	}
 	
@@ -764,10 +1030,15 @@ public:
 	struct RX_ADDR_P0
 	{
 		static const uint16_t __address = 10;
+		static const uint16_t __width = 40;
+		static const uint64_t __dflt = 0b1110011111100111111001111110011111100111;
+		static const uint64_t __reserved = 0b0000000000000000000000000000000000000000;
+		static const uint64_t __readonly = 0b0000000000000000000000000000000000000000;
 		
 		/* Bits RX_ADDR_P0: */
 		struct RX_ADDR_P0_
 		{
+			typedef RX_ADDR_P0 Register;
 			/* Mode:rw */
 			static const uint64_t dflt = 0b1110011111100111111001111110011111100111; // 40'he7e7e7e7e7
 			static const uint64_t mask = 0b1111111111111111111111111111111111111111; // [0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,19,20,21,22,23,24,25,26,27,28,29,30,31,32,33,34,35,36,37,38,39]
@@ -777,12 +1048,14 @@ public:
 	/* Set register RX_ADDR_P0 */
 	void setRX_ADDR_P0(uint64_t value)
 	{
+		NRF24L01_PROBE(write64);
 		write(RX_ADDR_P0::__address, value, 40);
 	}
 	
 	/* Get register RX_ADDR_P0 */
 	uint64_t getRX_ADDR_P0()
 	{
+		NRF24L01_PROBE(read64);
 		return read64(RX_ADDR_P0::__address, 40);
 	}
 	
@@ -802,10 +1075,15 @@ public:
 	struct RX_ADDR_P1
 	{
 		static const uint16_t __address = 11;
+		static const uint16_t __width = 40;
+		static const uint64_t __dflt = 0b1100001011000010110000101100001011000010;
+		static const uint64_t __reserved = 0b0000000000000000000000000000000000000000;
+		static const uint64_t __readonly = 0b0000000000000000000000000000000000000000;
 		
 		/* Bits RX_ADDR_P1: */
 		struct RX_ADDR_P1_
 		{
+			typedef RX_ADDR_P1 Register;
 			/* Mode:rw */
 			static const uint64_t dflt = 0b1100001011000010110000101100001011000010; // 40'hc2c2c2c2c2
 			static const uint64_t mask = 0b1111111111111111111111111111111111111111; // [0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,19,20,21,22,23,24,25,26,27,28,29,30,31,32,33,34,35,36,37,38,39]
@@ -815,12 +1093,14 @@ public:
 	/* Set register RX_ADDR_P1 */
 	void setRX_ADDR_P1(uint64_t value)
 	{
+		NRF24L01_PROBE(write64);
 		write(RX_ADDR_P1::__address, value, 40);
 	}
 	
 	/* Get register RX_ADDR_P1 */
 	uint64_t getRX_ADDR_P1()
 	{
+		NRF24L01_PROBE(read64);
 		return read64(RX_ADDR_P1::__address, 40);
 	}
 	
@@ -839,10 +1119,15 @@ public:
 	struct RX_ADDR_P2
 	{
 		static const uint16_t __address = 12;
+		static const uint16_t __width = 8;
+		static const uint8_t __dflt = 0b11000011;
+		static const uint8_t __reserved = 0b00000000;
+		static const uint8_t __readonly = 0b00000000;
 		
 		/* Bits RX_ADDR_P2: */
 		struct RX_ADDR_P2_
 		{
+			typedef RX_ADDR_P2 Register;
 			/* Mode:rw */
 			static const uint8_t dflt = 0b11000011; // 8'hc3
 			static const uint8_t mask = 0b11111111; // [0,1,2,3,4,5,6,7]
@@ -852,12 +1137,14 @@ public:
 	/* Set register RX_ADDR_P2 */
 	void setRX_ADDR_P2(uint8_t value)
 	{
+		NRF24L01_PROBE(write8);
 		write(RX_ADDR_P2::__address, value, 8);
 	}
 	
 	/* Get register RX_ADDR_P2 */
 	uint8_t getRX_ADDR_P2()
 	{
+		NRF24L01_PROBE(read8);
 		return read8(RX_ADDR_P2::__address, 8);
 	}
 	
@@ -876,10 +1163,15 @@ public:
 	struct RX_ADDR_P3
 	{
 		static const uint16_t __address = 13;
+		static const uint16_t __width = 8;
+		static const uint8_t __dflt = 0b11000100;
+		static const uint8_t __reserved = 0b00000000;
+		static const uint8_t __readonly = 0b00000000;
 		
 		/* Bits RX_ADDR_P3: */
 		struct RX_ADDR_P3_
 		{
+			typedef RX_ADDR_P3 Register;
 			/* Mode:rw */
 			static const uint8_t dflt = 0b11000100; // 8'hc4
 			static const uint8_t mask = 0b11111111; // [0,1,2,3,4,5,6,7]
@@ -889,12 +1181,14 @@ public:
 	/* Set register RX_ADDR_P3 */
 	void setRX_ADDR_P3(uint8_t value)
 	{
+		NRF24L01_PROBE(write8);
 		write(RX_ADDR_P3::__address, value, 8);
 	}
 	
 	/* Get register RX_ADDR_P3 */
 	uint8_t getRX_ADDR_P3()
 	{
+		NRF24L01_PROBE(read8);
 		return read8(RX_ADDR_P3::__address, 8);
 	}
 	
@@ -913,10 +1207,15 @@ public:
 	struct RX_ADDR_P4
 	{
 		static const uint16_t __address = 14;
+		static const uint16_t __width = 8;
+		static const uint8_t __dflt = 0b11000101;
+		static const uint8_t __reserved = 0b00000000;
+		static const uint8_t __readonly = 0b00000000;
 		
 		/* Bits RX_ADDR_P4: */
 		struct RX_ADDR_P4_
 		{
+			typedef RX_ADDR_P4 Register;
 			/* Mode:rw */
 			static const uint8_t dflt = 0b11000101; // 8'hc5
 			static const uint8_t mask = 0b11111111; // [0,1,2,3,4,5,6,7]
@@ -926,12 +1225,14 @@ public:
 	/* Set register RX_ADDR_P4 */
 	void setRX_ADDR_P4(uint8_t value)
 	{
+		NRF24L01_PROBE(write8);
 		write(RX_ADDR_P4::__address, value, 8);
 	}
 	
 	/* Get register RX_ADDR_P4 */
 	uint8_t getRX_ADDR_P4()
 	{
+		NRF24L01_PROBE(read8);
 		return read8(RX_ADDR_P4::__address, 8);
 	}
 	
@@ -950,10 +1251,15 @@ public:
 	struct RX_ADDR_P5
 	{
 		static const uint16_t __address = 15;
+		static const uint16_t __width = 8;
+		static const uint8_t __dflt = 0b11000110;
+		static const uint8_t __reserved = 0b00000000;
+		static const uint8_t __readonly = 0b00000000;
 		
 		/* Bits RX_ADDR_P5: */
 		struct RX_ADDR_P5_
 		{
+			typedef RX_ADDR_P5 Register;
 			/* Mode:rw */
 			static const uint8_t dflt = 0b11000110; // 8'hc6
 			static const uint8_t mask = 0b11111111; // [0,1,2,3,4,5,6,7]
@@ -963,12 +1269,14 @@ public:
 	/* Set register RX_ADDR_P5 */
 	void setRX_ADDR_P5(uint8_t value)
 	{
+		NRF24L01_PROBE(write8);
 		write(RX_ADDR_P5::__address, value, 8);
 	}
 	
 	/* Get register RX_ADDR_P5 */
 	uint8_t getRX_ADDR_P5()
 	{
+		NRF24L01_PROBE(read8);
 		return read8(RX_ADDR_P5::__address, 8);
 	}
 	
@@ -990,10 +1298,15 @@ public:
 	struct TX_ADDR
 	{
 		static const uint16_t __address = 16;
+		static const uint16_t __width = 40;
+		static const uint64_t __dflt = 0b1110011111100111111001111110011111100111;
+		static const uint64_t __reserved = 0b0000000000000000000000000000000000000000;
+		static const uint64_t __readonly = 0b0000000000000000000000000000000000000000;
 		
 		/* Bits TX_ADDR: */
 		struct TX_ADDR_
 		{
+			typedef TX_ADDR Register;
 			/* Mode:rw */
 			static const uint64_t dflt = 0b1110011111100111111001111110011111100111; // 40'he7e7e7e7e7
 			static const uint64_t mask = 0b1111111111111111111111111111111111111111; // [0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,19,20,21,22,23,24,25,26,27,28,29,30,31,32,33,34,35,36,37,38,39]
@@ -1003,12 +1316,14 @@ public:
 	/* Set register TX_ADDR */
 	void setTX_ADDR(uint64_t value)
 	{
+		NRF24L01_PROBE(write64);
 		write(TX_ADDR::__address, value, 40);
 	}
 	
 	/* Get register TX_ADDR */
 	uint64_t getTX_ADDR()
 	{
+		NRF24L01_PROBE(read64);
 		return read64(TX_ADDR::__address, 40);
 	}
 	
@@ -1024,11 +1339,16 @@ public:
 	struct RX_PW_P0
 	{
 		static const uint16_t __address = 17;
+		static const uint16_t __width = 8;
+		static const uint8_t __dflt = 0b00000000;
+		static const uint8_t __reserved = 0b11000000;
+		static const uint8_t __readonly = 0b00000000;
 		
 		/* Bits Reserved_0: */
 		/* Only '00' allowed  */
 		struct Reserved_0
 		{
+			typedef RX_PW_P0 Register;
 			static const uint8_t dflt = 0b00; // 2'b0
 			static const uint8_t mask = 0b11000000; // [6,7]
 		};
@@ -1042,6 +1362,7 @@ public:
 		 */
 		struct RX_PW_P0_
 		{
+			typedef RX_PW_P0 Register;
 			static const uint8_t dflt = 0b000000; // 6'b0
 			static const uint8_t mask = 0b00111111; // [0,1,2,3,4,5]
 			static const uint8_t PIPE_NOT_USED = 0b0000; // 
@@ -1051,12 +1372,14 @@ public:
 	/* Set register RX_PW_P0 */
 	void setRX_PW_P0(uint8_t value)
 	{
+		NRF24L01_PROBE(write8);
 		write(RX_PW_P0::__address, value, 8);
 	}
 	
 	/* Get register RX_PW_P0 */
 	uint8_t getRX_PW_P0()
 	{
+		NRF24L01_PROBE(read8);
 		return read8(RX_PW_P0::__address, 8);
 	}
 	
@@ -1072,11 +1395,16 @@ public:
 	struct RX_PW_P1
 	{
 		static const uint16_t __address = 18;
+		static const uint16_t __width = 8;
+		static const uint8_t __dflt = 0b00000000;
+		static const uint8_t __reserved = 0b11000000;
+		static const uint8_t __readonly = 0b00000000;
 		
 		/* Bits Reserved_0: */
 		/* Only '00' allowed  */
 		struct Reserved_0
 		{
+			typedef RX_PW_P1 Register;
 			/* Mode:rw */
 			static const uint8_t dflt = 0b00; // 2'b0
 			static const uint8_t mask = 0b11000000; // [6,7]
@@ -1091,6 +1419,7 @@ public:
 		 */
 		struct RX_PW_P1_
 		{
+			typedef RX_PW_P1 Register;
 			/* Mode:rw */
 			static const uint8_t dflt = 0b000000; // 6'b0
 			static const uint8_t mask = 0b00111111; // [0,1,2,3,4,5]
@@ -1101,12 +1430,14 @@ public:
 	/* Set register RX_PW_P1 */
 	void setRX_PW_P1(uint8_t value)
 	{
+		NRF24L01_PROBE(write8);
 		write(RX_PW_P1::__address, value, 8);
 	}
 	
 	/* Get register RX_PW_P1 */
 	uint8_t getRX_PW_P1()
 	{
+		NRF24L01_PROBE(read8);
 		return read8(RX_PW_P1::__address, 8);
 	}
 	
@@ -1122,11 +1453,16 @@ public:
 	struct RX_PW_P2
 	{
 		static const uint16_t __address = 19;
+		static const uint16_t __width = 8;
+		static const uint8_t __dflt = 0b00000000;
+		static const uint8_t __reserved = 0b11000000;
+		static const uint8_t __readonly = 0b00000000;
 		
 		/* Bits Reserved_0: */
 		/* Only '00' allowed  */
 		struct Reserved_0
 		{
+			typedef RX_PW_P2 Register;
 			static const uint8_t dflt = 0b00; // 2'b0
 			static const uint8_t mask = 0b11000000; // [6,7]
 		};
@@ -1141,6 +1477,7 @@ public:
 		 */
 		struct RX_PW_P2_
 		{
+			typedef RX_PW_P2 Register;
 			static const uint8_t dflt = 0b000000; // 6'b0
 			static const uint8_t mask = 0b00111111; // [0,1,2,3,4,5]
 			static const uint8_t PIPE_NOT_USED = 0b0000; // 
@@ -1150,12 +1487,14 @@ public:
 	/* Set register RX_PW_P2 */
 	void setRX_PW_P2(uint8_t value)
 	{
+		NRF24L01_PROBE(write8);
 		write(RX_PW_P2::__address, value, 8);
 	}
 	
 	/* Get register RX_PW_P2 */
 	uint8_t getRX_PW_P2()
 	{
+		NRF24L01_PROBE(read8);
 		return read8(RX_PW_P2::__address, 8);
 	}
 	
@@ -1171,11 +1510,16 @@ public:
 	struct RX_PW_P3
 	{
 		static const uint16_t __address = 20;
+		static const uint16_t __width = 8;
+		static const uint8_t __dflt = 0b00000000;
+		static const uint8_t __reserved = 0b11000000;
+		static const uint8_t __readonly = 0b00000000;
 		
 		/* Bits Reserved_0: */
 		/* Only '00' allowed  */
 		struct Reserved_0
 		{
+			typedef RX_PW_P3 Register;
 			static const uint8_t dflt = 0b00; // 2'b0
 			static const uint8_t mask = 0b11000000; // [6,7]
 		};
@@ -1190,6 +1534,7 @@ public:
 		 */
 		struct RX_PW_P3_
 		{
+			typedef RX_PW_P3 Register;
 			static const uint8_t dflt = 0b000000; // 6'b0
 			static const uint8_t mask = 0b00111111; // [0,1,2,3,4,5]
 			static const uint8_t PIPE_NOT_USED = 0b0000; // 
@@ -1199,12 +1544,14 @@ public:
 	/* Set register RX_PW_P3 */
 	void setRX_PW_P3(uint8_t value)
 	{
+		NRF24L01_PROBE(write8);
 		write(RX_PW_P3::__address, value, 8);
 	}
 	
 	/* Get register RX_PW_P3 */
 	uint8_t getRX_PW_P3()
 	{
+		NRF24L01_PROBE(read8);
 		return read8(RX_PW_P3::__address, 8);
 	}
 	
@@ -1220,11 +1567,16 @@ public:
 	struct RX_PW_P4
 	{
 		static const uint16_t __address = 21;
+		static const uint16_t __width = 8;
+		static const uint8_t __dflt = 0b00000000;
+		static const uint8_t __reserved = 0b11000000;
+		static const uint8_t __readonly = 0b00000000;
 		
 		/* Bits Reserved_0: */
 		/* Only '00' allowed  */
 		struct Reserved_0
 		{
+			typedef RX_PW_P4 Register;
 			static const uint8_t dflt = 0b00; // 2'b0
 			static const uint8_t mask = 0b11000000; // [6,7]
 		};
@@ -1239,6 +1591,7 @@ public:
 		 */
 		struct RX_PW_P4_
 		{
+			typedef RX_PW_P4 Register;
 			static const uint8_t dflt = 0b000000; // 6'b0
 			static const uint8_t mask = 0b00111111; // [0,1,2,3,4,5]
 			static const uint8_t PIPE_NOT_USED = 0b0000; // 
@@ -1248,12 +1601,14 @@ public:
 	/* Set register RX_PW_P4 */
 	void setRX_PW_P4(uint8_t value)
 	{
+		NRF24L01_PROBE(write8);
 		write(RX_PW_P4::__address, value, 8);
 	}
 	
 	/* Get register RX_PW_P4 */
 	uint8_t getRX_PW_P4()
 	{
+		NRF24L01_PROBE(read8);
 		return read8(RX_PW_P4::__address, 8);
 	}
 	
@@ -1269,11 +1624,16 @@ public:
 	struct RX_PW_P5
 	{
 		static const uint16_t __address = 22;
+		static const uint16_t __width = 8;
+		static const uint8_t __dflt = 0b00000000;
+		static const uint8_t __reserved = 0b11000000;
+		static const uint8_t __readonly = 0b00000000;
 		
 		/* Bits Reserved_0: */
 		/* Only '00' allowed  */
 		struct Reserved_0
 		{
+			typedef RX_PW_P5 Register;
 			static const uint8_t dflt = 0b00; // 2'b0
 			static const uint8_t mask = 0b11000000; // [6,7]
 		};
@@ -1288,6 +1648,7 @@ public:
 		 */
 		struct RX_PW_P5_
 		{
+			typedef RX_PW_P5 Register;
 			static const uint8_t dflt = 0b000000; // 6'b0
 			static const uint8_t mask = 0b00111111; // [0,1,2,3,4,5]
 			static const uint8_t PIPE_NOT_USED = 0b0000; // 
@@ -1297,12 +1658,14 @@ public:
 	/* Set register RX_PW_P5 */
 	void setRX_PW_P5(uint8_t value)
 	{
+		NRF24L01_PROBE(write8);
 		write(RX_PW_P5::__address, value, 8);
 	}
 	
 	/* Get register RX_PW_P5 */
 	uint8_t getRX_PW_P5()
 	{
+		NRF24L01_PROBE(read8);
 		return read8(RX_PW_P5::__address, 8);
 	}
 	
@@ -1320,11 +1683,16 @@ public:
 	struct FIFO_STATUS
 	{
 		static const uint16_t __address = 23;
+		static const uint16_t __width = 8;
+		static const uint8_t __dflt = 0b00010001;
+		static const uint8_t __reserved = 0b10001100;
+		static const uint8_t __readonly = 0b01110011;
 		
 		/* Bits Reserved_0: */
 		/* Only '0' allowed  */
 		struct Reserved_0
 		{
+			typedef FIFO_STATUS Register;
 			/* Mode:rw */
 			static const uint8_t dflt = 0b0; // 1'b0
 			static const uint8_t mask = 0b10000000; // [7]
@@ -1341,6 +1709,7 @@ public:
 		 */
 		struct TX_REUSE
 		{
+			typedef FIFO_STATUS Register;
 			/* Mode:r */
 			static const uint8_t dflt = 0b0; // 1'b0
 			static const uint8_t mask = 0b01000000; // [6]
@@ -1352,6 +1721,7 @@ public:
 		 */
 		struct TX_FULL
 		{
+			typedef FIFO_STATUS Register;
 			/* Mode:r */
 			static const uint8_t dflt = 0b0; // 1'b0
 			static const uint8_t mask = 0b00100000; // [5]
@@ -1364,6 +1734,7 @@ public:
 		 */
 		struct TX_EMPTY
 		{
+			typedef FIFO_STATUS Register;
 			/* Mode:r */
 			static const uint8_t dflt = 0b1; // 1'b1
 			static const uint8_t mask = 0b00010000; // [4]
@@ -1373,6 +1744,7 @@ public:
 		/* Only '00' allowed  */
 		struct Reserved_1
 		{
+			typedef FIFO_STATUS Register;
 			/* Mode:rw */
 			static const uint8_t dflt = 0b00; // 2'b0
 			static const uint8_t mask = 0b00001100; // [2,3]
@@ -1385,6 +1757,7 @@ public:
 		 */
 		struct RX_FULL
 		{
+			typedef FIFO_STATUS Register;
 			/* Mode:r */
 			static const uint8_t dflt = 0b0; // 1'b0
 			static const uint8_t mask = 0b00000010; // [1]
@@ -1397,6 +1770,7 @@ public:
 		 */
 		struct RX_EMPTY
 		{
+			typedef FIFO_STATUS Register;
 			/* Mode:r */
 			static const uint8_t dflt = 0b1; // 1'b1
 			static const uint8_t mask = 0b00000001; // [0]
@@ -1407,12 +1781,14 @@ public:
 	/* Set register FIFO_STATUS */
 	void setFIFO_STATUS(uint8_t value)
 	{
+		NRF24L01_PROBE(write8);
 		write(FIFO_STATUS::__address, value, 8);
 	}
 	
 	/* Get register FIFO_STATUS */
 	uint8_t getFIFO_STATUS()
 	{
+		NRF24L01_PROBE(read8);
 		return read8(FIFO_STATUS::__address, 8);
 	}
 	
@@ -1430,11 +1806,16 @@ public:
 	struct DYNPD
 	{
 		static const uint16_t __address = 28;
+		static const uint16_t __width = 8;
+		static const uint8_t __dflt = 0b00000000;
+		static const uint8_t __reserved = 0b11000000;
+		static const uint8_t __readonly = 0b00000000;
 		
 		/* Bits Reserved_0: */
 		/* Only 2'b00 allowed  */
 		struct Reserved_0
 		{
+			typedef DYNPD Register;
 			static const uint8_t dflt = 0b00; // 2'b0
 			static const uint8_t mask = 0b11000000; // [6,7]
 		};
@@ -1445,6 +1826,7 @@ public:
 		 */
 		struct DPL_P5
 		{
+			typedef DYNPD Register;
 			static const uint8_t dflt = 0b0; // 1'b0
 			static const uint8_t mask = 0b00100000; // [5]
 		};
@@ -1455,6 +1837,7 @@ public:
 		 */
 		struct DPL_P4
 		{
+			typedef DYNPD Register;
 			static const uint8_t dflt = 0b0; // 1'b0
 			static const uint8_t mask = 0b00010000; // [4]
 		};
@@ -1465,6 +1848,7 @@ public:
 		 */
 		struct DPL_P3
 		{
+			typedef DYNPD Register;
 			static const uint8_t dflt = 0b0; // 1'b0
 			static const uint8_t mask = 0b00001000; // [3]
 		};
@@ -1475,6 +1859,7 @@ public:
 		 */
 		struct DPL_P2
 		{
+			typedef DYNPD Register;
 			static const uint8_t dflt = 0b0; // 1'b0
 			static const uint8_t mask = 0b00000100; // [2]
 		};
@@ -1485,6 +1870,7 @@ public:
 		 */
 		struct DPL_P1
 		{
+			typedef DYNPD Register;
 			static const uint8_t dflt = 0b0; // 1'b0
 			static const uint8_t mask = 0b00000010; // [1]
 		};
@@ -1495,6 +1881,7 @@ public:
 		 */
 		struct DPL_P0
 		{
+			typedef DYNPD Register;
 			static const uint8_t dflt = 0b0; // 1'b0
 			static const uint8_t mask = 0b00000001; // [0]
 		};
@@ -1503,12 +1890,14 @@ public:
 	/* Set register DYNPD */
 	void setDYNPD(uint8_t value)
 	{
+		NRF24L01_PROBE(write8);
 		write(DYNPD::__address, value, 8);
 	}
 	
 	/* Get register DYNPD */
 	uint8_t getDYNPD()
 	{
+		NRF24L01_PROBE(read8);
 		return read8(DYNPD::__address, 8);
 	}
 	
@@ -1526,11 +1915,16 @@ public:
 	struct FEATURE
 	{
 		static const uint16_t __address = 29;
+		static const uint16_t __width = 8;
+		static const uint8_t __dflt = 0b00000000;
+		static const uint8_t __reserved = 0b11111000;
+		static const uint8_t __readonly = 0b00000000;
 		
 		/* Bits Reserved_0: */
 		/* Only 5'b00000 allowed  */
 		struct Reserved_0
 		{
+			typedef FEATURE Register;
 			static const uint8_t dflt = 0b00000; // 5'b0
 			static const uint8_t mask = 0b11111000; // [3,4,5,6,7]
 		};
@@ -1538,6 +1932,7 @@ public:
 		/* Enables Dynamic Payload Length  */
 		struct EN_DPL
 		{
+			typedef FEATURE Register;
 			static const uint8_t dflt = 0b0; // 1'b0
 			static const uint8_t mask = 0b00000100; // [2]
 		};
@@ -1545,21 +1940,759 @@ public:
 		/* Enables Payload with ACK  */
 		struct EN_ACK_PAYd
 		{
+			typedef FEATURE Register;
 			static const uint8_t dflt = 0b0; // 1'b0
 			static const uint8_t mask = 0b00000010; // [1]
 		};
+		/* Bits EN_DYN_ACK: */
+		/* Enables the W_TX_PAYLOAD_NOACK command  */
+		struct EN_DYN_ACK
+		{
+			typedef FEATURE Register;
+			static const uint8_t dflt = 0b0; // 1'b0
+			static const uint8_t mask = 0b00000001; // [0]
+		};
 	};
 	
 	/* Set register FEATURE */
 	void setFEATURE(uint8_t value)
 	{
+		NRF24L01_PROBE(write8);
 		write(FEATURE::__address, value, 8);
 	}
 	
 	/* Get register FEATURE */
 	uint8_t getFEATURE()
 	{
+		NRF24L01_PROBE(read8);
 		return read8(FEATURE::__address, 8);
 	}
 	
+	
+	/****************************************************************************************************\
+	 *                                                                                                  *
+	 *                                           REGISTER MAP                                           *
+	 *                                                                                                  *
+	\****************************************************************************************************/
+	
+	/*
+	 * Register map:
+	 * One entry per register, built from the register structs
+	 * in nRF24L01_.cpp. Register values are exchanged as
+	 * uint64_t[REGISTER_COUNT] in table order.
+	 */
+	struct RegisterInfo
+	{
+		const char *name;
+		uint8_t address;
+		uint8_t width;  // bits
+		uint64_t dflt;
+		uint8_t reserved;  // only the default value allowed
+		uint8_t readonly;  // ignored on write
+		uint8_t clear;  // write 1 to clear
+	};
+	
+	static const uint8_t REGISTER_COUNT = 26;
+	static const RegisterInfo REGISTERS[REGISTER_COUNT];
+	
+	/* Bits of a register that hold configuration */
+	static uint64_t configMask(const RegisterInfo &r)
+	{
+		uint64_t all = (1ull << r.width) - 1;
+		return all & ~(uint64_t)(r.reserved | r.readonly | r.clear);
+	}
+	
+	uint64_t readRegister(const RegisterInfo &r)
+	{
+		return r.width > 8 ? read64(r.address, r.width) : read8(r.address, r.width);
+	}
+	
+	/* Write configuration bits of a register, reserved bits are forced to their default */
+	void writeRegister(const RegisterInfo &r, uint64_t value)
+	{
+		value = (value & configMask(r)) | (r.dflt & r.reserved);
+		if (r.width > 8)
+			write(r.address, value, r.width);
+		else
+			write(r.address, (uint8_t)value, r.width);
+	}
+	
+	/* Read the registers selected by bit i of select, the other values are left as they are */
+	void readRegisters(uint64_t values[REGISTER_COUNT], uint32_t select=0xFFFFFFFF)
+	{
+		for (uint8_t i = 0; i < REGISTER_COUNT; i++)
+			if (select & (1u << i))
+				values[i] = readRegister(REGISTERS[i]);
+	}
+	
+	/* Write the registers selected by bit i of select, skipping registers without configuration bits */
+	void writeRegisters(const uint64_t values[REGISTER_COUNT], uint32_t select=0xFFFFFFFF)
+	{
+		for (uint8_t i = 0; i < REGISTER_COUNT; i++)
+			if ((select & (1u << i)) && configMask(REGISTERS[i]))
+				writeRegister(REGISTERS[i], values[i]);
+	}
+	
+	/* Returns a mask with bit i set if the configuration of register i differs */
+	static uint32_t diffRegisters(const uint64_t a[REGISTER_COUNT], const uint64_t b[REGISTER_COUNT])
+	{
+		uint32_t diff = 0;
+		for (uint8_t i = 0; i < REGISTER_COUNT; i++)
+			if ((a[i] ^ b[i]) & configMask(REGISTERS[i]))
+				diff |= 1u << i;
+		return diff;
+	}
+	
+	/*
+	 * Write a value composed with nRF24L01_Value. Registers without
+	 * writable bits, such as FIFO_STATUS, are rejected at compile time.
+	 */
+	template<class R>
+	void setRegister(const nRF24L01_Value<R> &value)
+	{
+		NRF24L01_STATIC_ASSERT((~(uint64_t)(R::__reserved | R::__readonly) & ((1ull << R::__width) - 1)) != 0);
+		if (R::__width > 8)
+			write(R::__address, (uint64_t)value.get(), R::__width);
+		else
+			write(R::__address, (uint8_t)value.get(), R::__width);
+	}
+	
+	/* Write reset values to all registers and clear the interrupt flags */
+	void resetToDefault()
+	{
+		for (uint8_t i = 0; i < REGISTER_COUNT; i++)
+			if (configMask(REGISTERS[i]))
+				writeRegister(REGISTERS[i], REGISTERS[i].dflt);
+		setSTATUS(STATUS::__clear);
+	}
+	
+	
+	/****************************************************************************************************\
+	 *                                                                                                  *
+	 *                                        CONSISTENCY CHECK                                         *
+	 *                                                                                                  *
+	\****************************************************************************************************/
+	
+	/*
+	 * Consistency check:
+	 * Cross register rules from the register descriptions and
+	 * the datasheet, evaluated over a register snapshot.
+	 */
+	struct Diagnostic
+	{
+		/* Codes */
+		static const uint8_t RESERVED_BITS = 0;  // reserved bits differ from their default
+		static const uint8_t CRC_FORCED = 1;  // EN_AA set with EN_CRC low, chip forces CRC on
+		static const uint8_t DPL_WITHOUT_EN_DPL = 2;  // DPL_Px set without FEATURE::EN_DPL
+		static const uint8_t DPL_WITHOUT_ENAA = 3;  // DPL_Px set without ENAA_Px
+		static const uint8_t DATA_RATE_RESERVED = 4;  // RF_DR_LOW and RF_DR_HIGH both set
+		static const uint8_t ARD_TOO_SHORT = 5;  // ARD below 500us at 250kbps
+		static const uint8_t ARD_SHORT_FOR_ACK_PAYLOAD = 6;  // ARD below 500us with ACK payloads
+		static const uint8_t ACK_PAYLOAD_WITHOUT_DPL = 7;  // EN_ACK_PAYd without EN_DPL and DPL_P0
+		static const uint8_t ADDRESS_WIDTH_ILLEGAL = 8;  // SETUP_AW::AW is '00'
+		static const uint8_t PIPE_WIDTH_ZERO = 9;  // enabled static pipe with RX_PW_Px 0
+		static const uint8_t PIPE_WIDTH_INVALID = 10;  // RX_PW_Px above 32
+		static const uint8_t CHANNEL_OUT_OF_RANGE = 11;  // RF_CH above 125 (2525MHz)
+		
+		/* Severities */
+		static const uint8_t WARNING = 0;  // works, but not as configured
+		static const uint8_t ERROR = 1;  // illegal or reserved setting
+		
+		uint8_t code;
+		uint8_t severity;
+		uint8_t address;  // register at fault
+		uint8_t pipe;  // 0xFF if not pipe specific
+	};
+	
+	/* Index of a register in REGISTERS */
+	static uint8_t registerIndex(uint16_t address)
+	{
+		return address < DYNPD::__address ? (uint8_t)address : (uint8_t)(address - DYNPD::__address + 24);
+	}
+	
+	/*
+	 * Check a register snapshot as read by readRegisters(). Stores up to
+	 * max diagnostics in out and returns the number of rule violations,
+	 * which may exceed max.
+	 */
+	static uint8_t checkConfig(const uint64_t values[REGISTER_COUNT], Diagnostic *out, uint8_t max)
+	{
+		uint8_t n = 0;
+		#define NRF24L01_V(R) ((uint8_t)values[registerIndex(R::__address)])
+		uint8_t config = NRF24L01_V(CONFIG), enaa = NRF24L01_V(EN_AA), rxaddr = NRF24L01_V(EN_RXADDR);
+		uint8_t setup = NRF24L01_V(RF_SETUP), retr = NRF24L01_V(SETUP_RETR);
+		uint8_t dynpd = NRF24L01_V(DYNPD), feature = NRF24L01_V(FEATURE);
+		#undef NRF24L01_V
+		
+		for (uint8_t i = 0; i < REGISTER_COUNT; i++)
+			if ((values[i] ^ REGISTERS[i].dflt) & REGISTERS[i].reserved)
+				report(out, max, n, Diagnostic::RESERVED_BITS, Diagnostic::ERROR, REGISTERS[i].address);
+		
+		if ((enaa & 0b00111111) && !(config & CONFIG::EN_CRC::mask))
+			report(out, max, n, Diagnostic::CRC_FORCED, Diagnostic::WARNING, CONFIG::__address);
+		
+		for (uint8_t pipe = 0; pipe < 6; pipe++)
+		{
+			uint8_t bit = 1 << pipe;
+			if ((dynpd & bit) && !(feature & FEATURE::EN_DPL::mask))
+				report(out, max, n, Diagnostic::DPL_WITHOUT_EN_DPL, Diagnostic::ERROR, FEATURE::__address, pipe);
+			if ((dynpd & bit) && !(enaa & bit))
+				report(out, max, n, Diagnostic::DPL_WITHOUT_ENAA, Diagnostic::ERROR, EN_AA::__address, pipe);
+			if (!(rxaddr & bit) || ((dynpd & bit) && (feature & FEATURE::EN_DPL::mask)))
+				continue;
+			uint8_t width = (uint8_t)values[registerIndex(RX_PW_P0::__address + pipe)];
+			if (width == 0)
+				report(out, max, n, Diagnostic::PIPE_WIDTH_ZERO, Diagnostic::WARNING, RX_PW_P0::__address + pipe, pipe);
+			else if ((width & RX_PW_P0::RX_PW_P0_::mask) > PAYLOAD_MAX)
+				report(out, max, n, Diagnostic::PIPE_WIDTH_INVALID, Diagnostic::ERROR, RX_PW_P0::__address + pipe, pipe);
+		}
+		
+		bool low = setup & RF_SETUP::RF_DR_LOW::mask;
+		if (low && (setup & RF_SETUP::RF_DR_HIGH::mask))
+			report(out, max, n, Diagnostic::DATA_RATE_RESERVED, Diagnostic::ERROR, RF_SETUP::__address);
+		
+		bool shortArd = (retr & SETUP_RETR::ARDa::mask) == 0;  /* 250us */
+		if (shortArd && low && (retr & SETUP_RETR::ARC::mask))
+			report(out, max, n, Diagnostic::ARD_TOO_SHORT, Diagnostic::ERROR, SETUP_RETR::__address);
+		else if (shortArd && (feature & FEATURE::EN_ACK_PAYd::mask))
+			report(out, max, n, Diagnostic::ARD_SHORT_FOR_ACK_PAYLOAD, Diagnostic::WARNING, SETUP_RETR::__address);
+		
+		if ((feature & FEATURE::EN_ACK_PAYd::mask) && !((feature & FEATURE::EN_DPL::mask) && (dynpd & DYNPD::DPL_P0::mask)))
+			report(out, max, n, Diagnostic::ACK_PAYLOAD_WITHOUT_DPL, Diagnostic::ERROR, FEATURE::__address, 0);
+		
+		if ((values[registerIndex(SETUP_AW::__address)] & SETUP_AW::AW::mask) == SETUP_AW::AW::ILLEGAL)
+			report(out, max, n, Diagnostic::ADDRESS_WIDTH_ILLEGAL, Diagnostic::ERROR, SETUP_AW::__address);
+		
+		if ((values[registerIndex(RF_CH::__address)] & RF_CH::RF_CH_::mask) > 125)
+			report(out, max, n, Diagnostic::CHANNEL_OUT_OF_RANGE, Diagnostic::ERROR, RF_CH::__address);
+		
+		return n;
+	}
+	
+	/* Read all registers and check them */
+	uint8_t checkConfig(Diagnostic *out, uint8_t max)
+	{
+		uint64_t values[REGISTER_COUNT];
+		readRegisters(values);
+		return checkConfig(values, out, max);
+	}
+	
+	
+	/****************************************************************************************************\
+	 *                                                                                                  *
+	 *                                             SNAPSHOT                                             *
+	 *                                                                                                  *
+	\****************************************************************************************************/
+	
+	/*
+	 * Register snapshot:
+	 * Compact blob of all registers for a warm restart, LSByte
+	 * first per register in table order, with a Fletcher-16
+	 * checksum. A restore writes only the registers that differ
+	 * and CONFIG last, so the chip powers up fully configured.
+	 */
+	struct SNAPSHOT
+	{
+		static const uint32_t MAGIC = 0x5346524E;  // "NRFS"
+		static const uint8_t VERSION = 1;
+		static const uint8_t HEADER = 6;  // magic, version, register count
+		static const uint8_t MAX = HEADER + REGISTER_COUNT * 5 + 2;
+		static const uint16_t POWER_UP_US = 1500;  // Tpd2stby
+	};
+	
+	static uint16_t fletcher16(const uint8_t *data, uint8_t n)
+	{
+		uint16_t a = 0, b = 0;
+		for (uint8_t i = 0; i < n; i++)
+		{
+			a = (a + data[i]) % 255;
+			b = (b + a) % 255;
+		}
+		return (uint16_t)(b << 8 | a);
+	}
+	
+	/* Encode values into blob (SNAPSHOT::MAX bytes), returns the blob size */
+	static uint8_t encodeSnapshot(const uint64_t values[REGISTER_COUNT], uint8_t *blob)
+	{
+		uint8_t n = 0;
+		for (uint8_t i = 0; i < 4; i++)
+			blob[n++] = (uint8_t)(SNAPSHOT::MAGIC >> (8 * i));
+		blob[n++] = SNAPSHOT::VERSION;
+		blob[n++] = REGISTER_COUNT;
+		for (uint8_t i = 0; i < REGISTER_COUNT; i++)
+			for (uint8_t bit = 0; bit < REGISTERS[i].width; bit += 8)
+				blob[n++] = (uint8_t)(values[i] >> bit);
+		uint16_t sum = fletcher16(blob, n);
+		blob[n++] = (uint8_t)sum;
+		blob[n++] = (uint8_t)(sum >> 8);
+		return n;
+	}
+	
+	/* Decode a blob, false if it is damaged or from another version */
+	static bool decodeSnapshot(const uint8_t *blob, uint8_t n, uint64_t values[REGISTER_COUNT])
+	{
+		if (n < SNAPSHOT::HEADER + 2 || fletcher16(blob, n - 2) != (blob[n - 2] | blob[n - 1] << 8))
+			return false;
+		uint32_t magic = blob[0] | blob[1] << 8 | blob[2] << 16 | (uint32_t)blob[3] << 24;
+		if (magic != SNAPSHOT::MAGIC || blob[4] != SNAPSHOT::VERSION || blob[5] != REGISTER_COUNT)
+			return false;
+		uint8_t p = SNAPSHOT::HEADER;
+		for (uint8_t i = 0; i < REGISTER_COUNT; i++)
+		{
+			values[i] = 0;
+			for (uint8_t bit = 0; bit < REGISTERS[i].width; bit += 8)
+			{
+				if (p >= n - 2)
+					return false;
+				values[i] |= (uint64_t)blob[p++] << bit;
+			}
+		}
+		return p == n - 2;
+	}
+	
+	/*
+	 * Read the registers into blob (SNAPSHOT::MAX bytes). Returns the blob
+	 * size, 0 if checkConfig() reports an error for the configuration.
+	 */
+	uint8_t saveSnapshot(uint8_t *blob)
+	{
+		uint64_t values[REGISTER_COUNT];
+		readRegisters(values);
+		Diagnostic diagnostics[64];
+		uint8_t n = checkConfig(values, diagnostics, 64);
+		for (uint8_t i = 0; i < n && i < 64; i++)
+			if (diagnostics[i].severity == Diagnostic::ERROR)
+				return 0;
+		return encodeSnapshot(values, blob);
+	}
+	
+	/*
+	 * Restore a blob from saveSnapshot(). Nothing is written if the chip
+	 * already matches; otherwise the differing registers are written, CONFIG
+	 * last, and read back. Stores the mask of written registers (bit i:
+	 * REGISTERS[i]) in written. Returns false if the blob is invalid or the
+	 * read back differs.
+	 */
+	bool restoreSnapshot(const uint8_t *blob, uint8_t n, uint32_t *written=0)
+	{
+		uint64_t wanted[REGISTER_COUNT], actual[REGISTER_COUNT];
+		if (written)
+			*written = 0;
+		if (!decodeSnapshot(blob, n, wanted))
+			return false;
+		readRegisters(actual);
+		uint32_t diff = diffRegisters(wanted, actual);
+		if (diff == 0)
+			return true;
+		uint8_t c = registerIndex(CONFIG::__address);
+		writeRegisters(wanted, diff & ~(1u << c));
+		if (diff & (1u << c))
+		{
+			writeRegisters(wanted, 1u << c);
+			if ((wanted[c] & CONFIG::PWR_UP::mask) && !(actual[c] & CONFIG::PWR_UP::mask))
+				delayUs(SNAPSHOT::POWER_UP_US);
+		}
+		if (written)
+			*written = diff;
+		readRegisters(actual);
+		return diffRegisters(wanted, actual) == 0;
+	}
+	
+	
+	/****************************************************************************************************\
+	 *                                                                                                  *
+	 *                                             COMMANDS                                             *
+	 *                                                                                                  *
+	\****************************************************************************************************/
+	
+	/*
+	 * SPI commands:
+	 * Issued through command(), see page 51
+	 */
+	struct CMD
+	{
+		static const uint8_t R_REGISTER = 0b00000000; // 000A AAAA
+		static const uint8_t W_REGISTER = 0b00100000; // 001A AAAA
+		static const uint8_t R_RX_PAYLOAD = 0b01100001; // 0110 0001
+		static const uint8_t W_TX_PAYLOAD = 0b10100000; // 1010 0000
+		static const uint8_t FLUSH_TX = 0b11100001; // 1110 0001
+		static const uint8_t FLUSH_RX = 0b11100010; // 1110 0010
+		static const uint8_t REUSE_TX_PL = 0b11100011; // 1110 0011
+		static const uint8_t R_RX_PL_WID = 0b01100000; // 0110 0000
+		static const uint8_t W_ACK_PAYLOAD = 0b10101000; // 1010 1PPP
+		static const uint8_t W_TX_PAYLOAD_NOACK = 0b10110000; // 1011 0000
+		static const uint8_t NOP = 0b11111111; // 1111 1111
+	};
+	
+	/* Max payload width in bytes */
+	static const uint8_t PAYLOAD_MAX = 32;
+	
+	/* Payloads held by the RX FIFO */
+	static const uint8_t RX_FIFO_DEPTH = 3;
+	
+	/* Write TX payload, returns STATUS */
+	uint8_t writeTxPayload(const uint8_t *buffer, uint8_t n)
+	{
+		NRF24L01_PROBE(command);
+		uint8_t status = command(CMD::W_TX_PAYLOAD, buffer, 0, n);
+#ifdef NRF24L01_INSTRUMENT
+		if (!stats.txAt)
+			stats.txAt = nRF24L01_cycles();
+#endif
+		return status;
+	}
+	
+	/* Write TX payload that is sent without auto acknowledgement (needs EN_DYN_ACK), returns STATUS */
+	uint8_t writeTxPayloadNoAck(const uint8_t *buffer, uint8_t n)
+	{
+		NRF24L01_PROBE(command);
+		return command(CMD::W_TX_PAYLOAD_NOACK, buffer, 0, n);
+	}
+	
+	/* Read RX payload, returns STATUS */
+	uint8_t readRxPayload(uint8_t *buffer, uint8_t n)
+	{
+		NRF24L01_PROBE(command);
+		uint8_t status = command(CMD::R_RX_PAYLOAD, 0, buffer, n);
+#ifdef NRF24L01_INSTRUMENT
+		if (stats.irqAt)
+		{
+			stats.irqToRx.add(nRF24L01_cycles() - stats.irqAt);
+			stats.irqAt = 0;
+		}
+#endif
+		return status;
+	}
+	
+	/* Flush TX FIFO, returns STATUS */
+	uint8_t flushTx()
+	{
+		NRF24L01_PROBE(command);
+		return command(CMD::FLUSH_TX, 0, 0, 0);
+	}
+	
+	/* Flush RX FIFO, returns STATUS */
+	uint8_t flushRx()
+	{
+		NRF24L01_PROBE(command);
+		return command(CMD::FLUSH_RX, 0, 0, 0);
+	}
+	
+	/*
+	 * IRQ service routine: read STATUS once, clear all asserted flags in
+	 * one write, then drain the RX FIFO into handler. Flags are cleared
+	 * before draining so a packet arriving during the drain raises a new
+	 * IRQ instead of being lost. RX_P_NO doubles as the RX FIFO empty
+	 * test (111), so each further payload costs one STATUS read instead
+	 * of a FIFO_STATUS and a STATUS read. width[] holds the static
+	 * payload width per pipe, 0 marks a dynamic payload length pipe.
+	 * At most RX_FIFO_DEPTH payloads are read per call, later arrivals
+	 * raise a new IRQ. Returns the served flags, TX_DS and MAX_RT are
+	 * left to the caller.
+	 */
+	uint8_t service(nRF24L01_ReceiveHandler handler, void *context, const uint8_t width[6])
+	{
+		markIrq();
+		uint8_t status = getSTATUS();
+		uint8_t flags = status & STATUS::__clear;
+		if (!flags)
+			return 0;
+		setSTATUS(flags);
+		if (!(flags & STATUS::RX_DR::mask))
+			return flags;
+		
+		uint8_t buffer[PAYLOAD_MAX];
+		uint8_t pipe;
+		for (uint8_t i = 0; i < RX_FIFO_DEPTH && (pipe = (status & STATUS::RX_P_NO::mask) >> 1) < 6; i++)
+		{
+			uint8_t n = width[pipe];
+			if (n)
+				readRxPayload(buffer, n);
+			else
+				n = readDynamicPayload(buffer);
+			if (handler && n)
+				handler(context, pipe, buffer, n);
+			status = getSTATUS();
+		}
+		return flags;
+	}
+	
+	/* Read width of the RX FIFO head, for pipes with dynamic payload length */
+	uint8_t readPayloadWidth()
+	{
+		uint8_t width = 0;
+		NRF24L01_PROBE(command);
+		command(CMD::R_RX_PL_WID, 0, &width, 1);
+		return width;
+	}
+	
+	/*
+	 * Enable dynamic payload length on the pipes in mask (bit i: pipe i).
+	 * Sets FEATURE::EN_DPL and the ENAA_Px bits the pipes require.
+	 */
+	void enableDynamicPayloads(uint8_t pipes)
+	{
+		pipes &= 0b00111111;
+		setFEATURE(getFEATURE() | FEATURE::EN_DPL::mask);
+		setEN_AA(getEN_AA() | pipes);
+		setDYNPD(getDYNPD() | pipes);
+	}
+	
+	/* Pulse CE to start transmission of the TX FIFO head (min. 10us) */
+	void pulseCe()
+	{
+		ce(true);
+		delayUs(10);
+		ce(false);
+	}
+	
+	
+	/****************************************************************************************************\
+	 *                                                                                                  *
+	 *                                            BROADCAST                                             *
+	 *                                                                                                  *
+	\****************************************************************************************************/
+	
+	/*
+	 * Broadcast:
+	 * One-to-many transmission to a multicast address shared by
+	 * all receivers. Packets are sent with W_TX_PAYLOAD_NOACK, so
+	 * no receiver acknowledges and none is retransmitted; send
+	 * copies instead where loss matters, receivers see every copy.
+	 */
+	
+	/* Transmitter: enable per packet no-ack and address the shared address */
+	void enableBroadcast(uint64_t address)
+	{
+		setFEATURE(getFEATURE() | FEATURE::EN_DYN_ACK::mask);
+		setTX_ADDR(address);
+	}
+	
+	/*
+	 * Receiver: listen to the shared address on pipe. Pipes 2 to 5 only
+	 * hold the LSByte, the other bytes are those of RX_ADDR_P1.
+	 */
+	void joinBroadcast(uint8_t pipe, uint64_t address)
+	{
+		if (pipe == 0)
+			setRX_ADDR_P0(address);
+		else if (pipe == 1)
+			setRX_ADDR_P1(address);
+		else if (pipe < 6)
+			write(RX_ADDR_P2::__address + pipe - 2, (uint8_t)address, 8);
+		else
+			return;
+		setEN_RXADDR(getEN_RXADDR() | (1 << pipe));
+	}
+	
+	/*
+	 * Queue copies of payload without ACK and keep CE high, so they go out
+	 * back to back. Returns the copies queued, fewer if the TX FIFO (3
+	 * deep) filled up. Each sent copy raises TX_DS.
+	 */
+	uint8_t sendBroadcast(const uint8_t *buffer, uint8_t n, uint8_t copies=1)
+	{
+		uint8_t queued = 0;
+		while (queued < copies && !(writeTxPayloadNoAck(buffer, n) & STATUS::TX_FULL::mask))
+			queued++;
+		ce(true);
+		return queued;
+	}
+	
+	
+	/****************************************************************************************************\
+	 *                                                                                                  *
+	 *                                        LISTEN BEFORE TALK                                        *
+	 *                                                                                                  *
+	\****************************************************************************************************/
+	
+	/*
+	 * Listen before talk:
+	 * Enter RX on the target channel and sample RPD before
+	 * transmitting. RPD settles after 170us in RX and is
+	 * latched when CE goes low, see section 6.4 on page 25.
+	 * If the channel is occupied, back off a random number
+	 * of slots from a window that doubles on each attempt.
+	 * The backoff is seeded from the node's own address,
+	 * RX_ADDR_P1, unless seedRandom() was called. Nodes left
+	 * at the default RX_ADDR_P1 draw the same backoff and
+	 * retry in lockstep; seed those from a hardware id.
+	 */
+	struct LBT
+	{
+		static const uint32_t LISTEN_US = 170; // RPD settle time in RX
+		static const uint32_t SLOT_US = 250; // backoff slot
+		static const uint8_t MAX_EXPONENT = 8; // window at most 255 slots
+	};
+	
+	/*
+	 * Returns true if the channel is clear, false after maxAttempts busy
+	 * samples or if the radio is powered down, RPD is not valid then.
+	 * CONFIG is restored, so a receiver stays one.
+	 */
+	bool listenBeforeTalk(uint8_t channel, uint8_t maxAttempts=8)
+	{
+		uint8_t config = getCONFIG();
+		if (!(config & CONFIG::PWR_UP::mask))
+			return false;
+		channel &= RF_CH::RF_CH_::mask;
+		if ((getRF_CH() & RF_CH::RF_CH_::mask) != channel)  /* writing RF_CH resets PLOS_CNT */
+			setRF_CH(channel);
+		
+		bool clear = false;
+		for (uint8_t attempt = 0; attempt < maxAttempts; attempt++)
+		{
+			setCONFIG(config | CONFIG::PRIM_RX::mask);
+			ce(true);
+			delayUs(LBT::LISTEN_US);
+			ce(false);  /* latches RPD */
+			if (!(getRPD() & RPD::RPD_::mask))
+			{
+				clear = true;
+				break;
+			}
+			if (attempt + 1 == maxAttempts)
+				break;
+			uint8_t exponent = attempt + 1 < LBT::MAX_EXPONENT ? attempt + 1 : LBT::MAX_EXPONENT;
+			delayUs((nextRandom() & ((1u << exponent) - 1)) * LBT::SLOT_US);
+		}
+		setCONFIG(config);
+		return clear;
+	}
+	
+	/* Seed the backoff, e.g. from a unique id or ADC noise; 0 selects the RX_ADDR_P1 default */
+	void seedRandom(uint32_t value)
+	{
+		seed = value;
+	}
+	
+	/*
+	 * Load and send payload once the channel is clear, returns false if it
+	 * stayed busy. Leaves the radio in TX mode (PRIM_RX 0), switch back to
+	 * RX after TX_DS or MAX_RT.
+	 */
+	bool sendListenBeforeTalk(const uint8_t *buffer, uint8_t n, uint8_t channel, uint8_t maxAttempts=8)
+	{
+		if (!listenBeforeTalk(channel, maxAttempts))
+			return false;
+		uint8_t config = getCONFIG();
+		if (config & CONFIG::PRIM_RX::mask)
+			setCONFIG(config & ~CONFIG::PRIM_RX::mask);
+		writeTxPayload(buffer, n);
+		pulseCe();
+		return true;
+	}
+	
+protected:
+	static void report(Diagnostic *out, uint8_t max, uint8_t &n, uint8_t code, uint8_t severity, uint8_t address, uint8_t pipe=0xFF)
+	{
+		if (n < max)
+		{
+			out[n].code = code;
+			out[n].severity = severity;
+			out[n].address = address;
+			out[n].pipe = pipe;
+		}
+		n++;
+	}
+	
+	/* xorshift32, used for randomized backoff */
+	uint32_t nextRandom()
+	{
+		if (seed == 0)
+		{
+			uint64_t address = getRX_ADDR_P1();
+			seed = (uint32_t)(address ^ (address >> 32)) * 0x9E3779B1u;
+			if (seed == 0)
+				seed = 0x2545F491u;
+		}
+		seed ^= seed << 13;
+		seed ^= seed >> 17;
+		seed ^= seed << 5;
+		return seed;
+	}
+	
+	uint32_t seed;
+};
+
+
+/* Number of trailing zero bits of mask, i.e. the shift of a field */
+template<uint64_t mask> struct nRF24L01_Shift
+{
+	static const unsigned value = mask & 1 ? 0 : 1 + nRF24L01_Shift<(mask >> 1)>::value;
+};
+template<> struct nRF24L01_Shift<0>
+{
+	static const unsigned value = 0;
+};
+
+/*
+ * Register value composed from fields of register R, e.g.
+ *   nRF24L01_Value<nRF24L01_Base::CONFIG>()
+ *       .set<nRF24L01_Base::CONFIG::EN_CRC, 1>()
+ *       .set<nRF24L01_Base::CONFIG::PWR_UP>(on)
+ * Fields of other registers, fields that are reserved or read-only in R
+ * and constant values that do not fit the field do not compile. Reserved
+ * bits hold their default, fields not set are zero. All checks are
+ * resolved at compile time.
+ */
+template<class R>
+class nRF24L01_Value
+{
+public:
+	nRF24L01_Value() : value(R::__dflt & R::__reserved) {}
+	
+	/* Set field F to a run time value, excess bits are dropped */
+	template<class F>
+	nRF24L01_Value &set(uint64_t v)
+	{
+		check<F>();
+		value = (value & ~(uint64_t)F::mask) | ((v << nRF24L01_Shift<F::mask>::value) & F::mask);
+		return *this;
+	}
+	
+	/* Set field F to constant V, which must fit the field */
+	template<class F, uint64_t V>
+	nRF24L01_Value &set()
+	{
+		NRF24L01_STATIC_ASSERT(((V << nRF24L01_Shift<F::mask>::value) & ~(uint64_t)F::mask) == 0);
+		return set<F>(V);
+	}
+	
+	uint64_t get() const
+	{
+		return value;
+	}
+	
+private:
+	/* F must be a field of R, writable and inside the register */
+	template<class F>
+	static void check()
+	{
+		NRF24L01_STATIC_ASSERT((nRF24L01_SameType<typename F::Register, R>::value));
+		NRF24L01_STATIC_ASSERT((F::mask & (R::__reserved | R::__readonly)) == 0);
+		NRF24L01_STATIC_ASSERT(((uint64_t)F::mask >> R::__width) == 0);
+	}
+	
+	uint64_t value;
 };
+
+/*
+ * Read the RX FIFO head of a dynamic payload length pipe. Returns the
+ * number of bytes read, 0 if the width was corrupt (0 or above 32) and
+ * the RX FIFO had to be flushed, see R_RX_PL_WID on page 51. A width of
+ * 0 reads nothing, so the head would otherwise never leave the FIFO.
+ */
+inline uint8_t nRF24L01_Base::readDynamicPayload(uint8_t *buffer)
+{
+	uint8_t n = readPayloadWidth();
+	if (n == 0 || n > PAYLOAD_MAX)
+	{
+		flushRx();
+		return 0;
+	}
+	readRxPayload(buffer, n);
+	return n;
+}
+
+#endif
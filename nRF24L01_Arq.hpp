@@ -0,0 +1,218 @@
+/*
+ * name:        nRF24L01+
+ * description: Single Chip 2.4GHz Transceiver
+ * manuf:       Nordic Semiconductor
+ * version:     0.1
+ * url:         https://www.nordicsemi.com/eng/content/download/2726/34069/file/nRF24L01P_Product_Specification_1_0.pdf
+ * date:        2017-12-19
+ * author       https://chisl.io/
+ * file:        nRF24L01_Arq.hpp
+ */
+
+#ifndef NRF24L01_ARQ_HPP
+#define NRF24L01_ARQ_HPP
+
+#include "nRF24L01_.hpp"
+#include <cstring>
+
+/*
+ * Selective repeat ARQ above no-ack hardware mode. The sender keeps up to W
+ * frames (W a power of two up to 32) in flight and sends them with
+ * W_TX_PAYLOAD_NOACK, so the air stays busy instead of waiting for each
+ * hardware ACK; its constructor sets FEATURE::EN_DYN_ACK, without which the
+ * chip ignores that command. The receiver delivers in order and answers
+ * with reverse ACK frames carrying the next expected sequence number and a
+ * bitmap of the frames buffered beyond it; the sender only repeats frames
+ * that are neither acknowledged nor buffered once their timeout expires.
+ * Frames are not lost after MAX_RT as with hardware auto-ack, they stay in
+ * the window until acknowledged.
+ *
+ * Turning the link around (PTX/PRX) for the reverse frames is left to the
+ * application, e.g. with nRF24L01_Async or the ACK payload of another link.
+ * A receiver sending its ACK frames with W_TX_PAYLOAD_NOACK needs
+ * EN_DYN_ACK as well, e.g. through nRF24L01_Base::enableBroadcast().
+ */
+
+/* Frame layout */
+struct nRF24L01_ArqFrame
+{
+	static const uint8_t DATA = 0xA0;  // DATA, seq, payload
+	static const uint8_t ACK = 0xA1;  // ACK, next expected seq, 32 bit bitmap (LSB first)
+	static const uint8_t HEADER = 2;
+	static const uint8_t ACK_SIZE = 6;
+	static const uint8_t PAYLOAD_MAX = nRF24L01_Base::PAYLOAD_MAX - HEADER;
+};
+
+
+template<uint8_t W=16>
+class nRF24L01_ArqSender
+{
+public:
+	typedef nRF24L01_ArqFrame F;
+
+	nRF24L01_ArqSender(nRF24L01_Base &radio, uint32_t timeoutUs)
+		: radio(radio), timeoutUs(timeoutUs), retransmissions(0), base(0), next(0)
+	{
+		NRF24L01_STATIC_ASSERT(W > 0 && W <= 32 && (W & (W - 1)) == 0);
+		std::memset(slot, 0, sizeof(slot));
+		radio.setFEATURE(radio.getFEATURE() | nRF24L01_Base::FEATURE::EN_DYN_ACK::mask);
+	}
+
+	/* Queue a payload of at most F::PAYLOAD_MAX bytes, false if the window is full */
+	bool send(const uint8_t *buffer, uint8_t n)
+	{
+		if (inFlight() == W || n > F::PAYLOAD_MAX)
+			return false;
+		Slot &s = slot[next % W];
+		s.frame[0] = F::DATA;
+		s.frame[1] = next++;
+		std::memcpy(s.frame + F::HEADER, buffer, n);
+		s.n = n + F::HEADER;
+		s.sent = s.acked = false;
+		return true;
+	}
+
+	/* Frames not yet acknowledged */
+	uint8_t inFlight() const
+	{
+		return (uint8_t)(next - base);
+	}
+
+	/* Load frames that are new or timed out into the TX FIFO, returns the number loaded */
+	uint8_t transmit(uint32_t now)
+	{
+		uint8_t loaded = 0;
+		for (uint8_t seq = base; seq != next; seq++)
+		{
+			Slot &s = slot[seq % W];
+			if (s.acked || (s.sent && now - s.sentAt < timeoutUs))
+				continue;
+			if (radio.writeTxPayloadNoAck(s.frame, s.n) & nRF24L01_Base::STATUS::TX_FULL::mask)
+				break;
+			if (s.sent)
+				retransmissions++;
+			s.sent = true;
+			s.sentAt = now;
+			loaded++;
+		}
+		if (loaded)
+			radio.ce(true);
+		return loaded;
+	}
+
+	/* Process an ACK frame */
+	void onAck(const uint8_t *frame, uint8_t n)
+	{
+		if (n < F::ACK_SIZE || frame[0] != F::ACK)
+			return;
+		uint8_t expected = frame[1];
+		if ((uint8_t)(expected - base) > inFlight())
+			return;  /* stale or foreign */
+		base = expected;
+		uint32_t bitmap = frame[2] | frame[3] << 8 | frame[4] << 16 | (uint32_t)frame[5] << 24;
+		for (uint8_t i = 0; bitmap && i < 32; i++, bitmap >>= 1)
+		{
+			uint8_t seq = expected + 1 + i;
+			if ((bitmap & 1) && (uint8_t)(seq - base) < inFlight())
+				slot[seq % W].acked = true;
+		}
+	}
+
+	/* nRF24L01_ReceiveHandler for nRF24L01_Base::service(), context is the sender */
+	static void handler(void *context, uint8_t pipe, const uint8_t *data, uint8_t n)
+	{
+		(void)pipe;
+		static_cast<nRF24L01_ArqSender *>(context)->onAck(data, n);
+	}
+
+	nRF24L01_Base &radio;
+	uint32_t timeoutUs;
+	uint32_t retransmissions;
+
+private:
+	struct Slot
+	{
+		uint8_t frame[nRF24L01_Base::PAYLOAD_MAX];
+		uint8_t n;
+		bool sent, acked;
+		uint32_t sentAt;
+	};
+
+	Slot slot[W];
+	uint8_t base, next;
+};
+
+
+template<uint8_t W=16>
+class nRF24L01_ArqReceiver
+{
+public:
+	typedef nRF24L01_ArqFrame F;
+
+	/* deliver receives the payloads in sequence order */
+	nRF24L01_ArqReceiver(nRF24L01_ReceiveHandler deliver, void *context=0)
+		: deliver(deliver), context(context), expected(0), buffered(0)
+	{
+		NRF24L01_STATIC_ASSERT(W > 0 && W <= 32 && (W & (W - 1)) == 0);
+	}
+
+	/* Process a DATA frame, returns true if an ACK frame should be sent */
+	bool onData(uint8_t pipe, const uint8_t *frame, uint8_t n)
+	{
+		if (n < F::HEADER || frame[0] != F::DATA)
+			return false;
+		uint8_t offset = frame[1] - expected;
+		if (offset >= W)
+			return offset >= 256 - W;  /* duplicate of a delivered frame: its ACK was lost */
+		if (offset == 0)
+		{
+			deliver(context, pipe, frame + F::HEADER, n - F::HEADER);
+			expected++;
+			buffered >>= 1;
+			while (buffered & 1)  /* bit 0: frame expected is buffered */
+			{
+				Slot &s = slot[expected % W];
+				deliver(context, pipe, s.data, s.n);
+				expected++;
+				buffered >>= 1;
+			}
+		}
+		else
+		{
+			Slot &s = slot[frame[1] % W];
+			s.n = n - F::HEADER;
+			std::memcpy(s.data, frame + F::HEADER, s.n);
+			buffered |= 1u << offset;
+		}
+		return true;
+	}
+
+	/* Build the ACK frame into frame, returns its length */
+	uint8_t buildAck(uint8_t *frame) const
+	{
+		uint32_t bitmap = buffered >> 1;  /* bit i: expected + 1 + i */
+		frame[0] = F::ACK;
+		frame[1] = expected;
+		frame[2] = (uint8_t)bitmap;
+		frame[3] = (uint8_t)(bitmap >> 8);
+		frame[4] = (uint8_t)(bitmap >> 16);
+		frame[5] = (uint8_t)(bitmap >> 24);
+		return F::ACK_SIZE;
+	}
+
+	nRF24L01_ReceiveHandler deliver;
+	void *context;
+
+private:
+	struct Slot
+	{
+		uint8_t data[F::PAYLOAD_MAX];
+		uint8_t n;
+	};
+
+	Slot slot[W];
+	uint8_t expected;
+	uint32_t buffered;  // bit i: expected + i is buffered
+};
+
+#endif
@@ -0,0 +1,149 @@
+/*
+ * name:        nRF24L01+
+ * description: Single Chip 2.4GHz Transceiver
+ * manuf:       Nordic Semiconductor
+ * version:     0.1
+ * url:         https://www.nordicsemi.com/eng/content/download/2726/34069/file/nRF24L01P_Product_Specification_1_0.pdf
+ * date:        2017-12-19
+ * author       https://chisl.io/
+ * file:        nRF24L01_Async.hpp
+ */
+
+#ifndef NRF24L01_ASYNC_HPP
+#define NRF24L01_ASYNC_HPP
+
+#include "nRF24L01_.hpp"
+#include <cstring>
+
+/*
+ * Non-blocking send and receive. Requests are queued in a fixed pool of N
+ * slots and completed from poll(), which reacts to STATUS::TX_DS, MAX_RT and
+ * RX_DR. One thread can serve any number of radios by calling poll() on each
+ * (e.g. when their IRQ line fires). Nothing is allocated per packet.
+ *
+ * One packet is in the TX FIFO at a time, so each TX_DS or MAX_RT belongs to
+ * exactly one request. While idle with a receive handler the radio listens
+ * as PRX and switches to PTX for each send. Pipes with DYNPD set while
+ * FEATURE::EN_DPL is on are read with their dynamic payload length, the
+ * others with RX_PW_Px, whatever is left in RX_PW_Px of dynamic pipes.
+ */
+
+/* Send completion, result is STATUS::TX_DS::mask or STATUS::MAX_RT::mask */
+typedef void (*nRF24L01_SendCompletion)(void *context, uint8_t result);
+
+template<uint8_t N=8>
+class nRF24L01_Async
+{
+public:
+	typedef nRF24L01_Base B;
+
+	nRF24L01_Async(nRF24L01_Base &radio)
+		: radio(radio), head(0), count(0), busy(false), handler(0), handlerContext(0)
+	{
+		std::memset(width, 0, sizeof(width));
+	}
+
+	/*
+	 * Queue payload for sending, it is copied into the pool. completion is
+	 * called from poll(). Returns false if the pool is exhausted.
+	 */
+	bool sendAsync(const uint8_t *buffer, uint8_t n, nRF24L01_SendCompletion completion, void *context=0)
+	{
+		if (count == N)
+			return false;
+		Request &r = pool[(head + count++) % N];
+		r.n = n > B::PAYLOAD_MAX ? B::PAYLOAD_MAX : n;
+		std::memcpy(r.data, buffer, r.n);
+		r.completion = completion;
+		r.context = context;
+		if (!busy)
+			start();
+		return true;
+	}
+
+	/* Deliver received payloads to handler, 0 stops receiving */
+	void receiveAsync(nRF24L01_ReceiveHandler handler, void *context=0)
+	{
+		this->handler = handler;
+		handlerContext = context;
+		uint8_t dynamic = radio.getFEATURE() & B::FEATURE::EN_DPL::mask ? radio.getDYNPD() : 0;
+		for (uint8_t pipe = 0; pipe < 6; pipe++)
+			width[pipe] = dynamic & (1 << pipe) ? 0 : radio.read8(B::RX_PW_P0::__address + pipe) & B::RX_PW_P0::RX_PW_P0_::mask;
+		if (!busy)
+			listen(handler != 0);
+	}
+
+	/* Handle pending events, returns the STATUS flags that were served */
+	uint8_t poll()
+	{
+		uint8_t flags = radio.service(handler, handlerContext, width);
+		if (busy && (flags & (B::STATUS::TX_DS::mask | B::STATUS::MAX_RT::mask)))
+			complete(flags & B::STATUS::TX_DS::mask ? B::STATUS::TX_DS::mask : B::STATUS::MAX_RT::mask);
+		return flags;
+	}
+
+	/* Requests queued or in flight */
+	uint8_t pending() const
+	{
+		return count;
+	}
+
+	nRF24L01_Base &radio;
+
+protected:
+	/* Pool slot */
+	struct Request
+	{
+		uint8_t n;
+		uint8_t data[B::PAYLOAD_MAX];
+		nRF24L01_SendCompletion completion;
+		void *context;
+	};
+
+	void start()
+	{
+		Request &r = pool[head];
+		listen(false);
+		radio.writeTxPayload(r.data, r.n);
+		radio.pulseCe();
+		busy = true;
+	}
+
+	void complete(uint8_t result)
+	{
+		if (result == B::STATUS::MAX_RT::mask)
+			radio.flushTx();  /* the failed payload stays in the FIFO otherwise */
+		Request r = pool[head];
+		head = (head + 1) % N;
+		count--;
+		busy = false;
+		if (count)
+			start();
+		else if (handler)
+			listen(true);
+		if (r.completion)
+			r.completion(r.context, result);
+	}
+
+	void listen(bool on)
+	{
+		uint8_t config = radio.getCONFIG();
+		radio.ce(false);
+		if (on)
+		{
+			radio.setCONFIG(config | B::CONFIG::PRIM_RX::mask);
+			radio.ce(true);
+		}
+		else if (config & B::CONFIG::PRIM_RX::mask)
+			radio.setCONFIG(config & ~B::CONFIG::PRIM_RX::mask);
+	}
+
+	Request pool[N];
+	uint8_t head, count;
+	bool busy;
+	nRF24L01_ReceiveHandler handler;
+	void *handlerContext;
+	uint8_t width[6];
+};
+
+#endif
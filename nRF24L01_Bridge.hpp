@@ -0,0 +1,207 @@
+/*
+ * name:        nRF24L01+
+ * description: Single Chip 2.4GHz Transceiver
+ * manuf:       Nordic Semiconductor
+ * version:     0.1
+ * url:         https://www.nordicsemi.com/eng/content/download/2726/34069/file/nRF24L01P_Product_Specification_1_0.pdf
+ * date:        2017-12-19
+ * author       https://chisl.io/
+ * file:        nRF24L01_Bridge.hpp
+ */
+
+#ifndef NRF24L01_BRIDGE_HPP
+#define NRF24L01_BRIDGE_HPP
+
+#include "nRF24L01_.hpp"
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+/*
+ * Gateway bridge (Linux): payloads received from any number of radios are
+ * read by poll() from the RX FIFO straight into a ring of N records and
+ * handed to the socket in batches, with sendmmsg() for datagram sockets
+ * (UDP, Unix SOCK_DGRAM) or one gathering sendmsg() for stream sockets.
+ * The iovecs point into the ring, so a payload is not copied between the
+ * SPI read and the kernel. push() and handler() take payloads read
+ * elsewhere and copy them in.
+ *
+ * Each record is a 4 byte header (radio id, pipe, length, 0) followed by the
+ * payload; datagram sockets get one record per datagram, on stream sockets
+ * the header frames the records.
+ */
+
+/* Record as sent to the socket */
+struct nRF24L01_BridgeRecord
+{
+	static const uint8_t HEADER = 4;
+
+	uint8_t radio;
+	uint8_t pipe;
+	uint8_t length;
+	uint8_t flags;
+	uint8_t payload[nRF24L01_Base::PAYLOAD_MAX];
+};
+
+template<unsigned N=64>
+class nRF24L01_Bridge
+{
+public:
+	typedef nRF24L01_BridgeRecord R;
+
+	/* fd: connected socket, stream for SOCK_STREAM sockets */
+	nRF24L01_Bridge(int fd, bool stream=false)
+		: fd(fd), stream(stream), sent(0), dropped(0), source(0), head(0), count(0), partial(0) {}
+
+	/*
+	 * Serve one radio like nRF24L01_Base::service() and queue its payloads
+	 * under id, each read directly into its ring slot. Payloads that find
+	 * the ring full after a flush are read and dropped. Returns the STATUS
+	 * flags served, TX_DS and MAX_RT are left to the caller.
+	 */
+	uint8_t poll(nRF24L01_Base &radio, uint8_t id, const uint8_t width[6])
+	{
+		typedef nRF24L01_Base B;
+		radio.markIrq();
+		uint8_t status = radio.getSTATUS();
+		uint8_t flags = status & B::STATUS::__clear;
+		if (!flags)
+			return 0;
+		radio.setSTATUS(flags);
+		if (!(flags & B::STATUS::RX_DR::mask))
+			return flags;
+
+		uint8_t pipe;
+		for (uint8_t i = 0; i < B::RX_FIFO_DEPTH && (pipe = (status & B::STATUS::RX_P_NO::mask) >> 1) < 6; i++)
+		{
+			if (count == N)
+				flush();
+			R scratch;
+			R &r = count < N ? ring[(head + count) % N] : scratch;
+			uint8_t n = width[pipe];
+			if (n)
+				radio.readRxPayload(r.payload, n);
+			else
+				n = radio.readDynamicPayload(r.payload);
+			if (n && &r != &scratch)
+			{
+				r.radio = id;
+				r.pipe = pipe;
+				r.length = n;
+				r.flags = 0;
+				count++;
+			}
+			else if (n)
+				dropped++;
+			status = radio.getSTATUS();
+		}
+		return flags;
+	}
+
+	/* nRF24L01_ReceiveHandler for payloads read elsewhere, context is the bridge */
+	static void handler(void *context, uint8_t pipe, const uint8_t *data, uint8_t n)
+	{
+		nRF24L01_Bridge *b = static_cast<nRF24L01_Bridge *>(context);
+		b->push(b->source, pipe, data, n);
+	}
+
+	/* Queue a record, flushing first if the ring is full; false if it had to be dropped */
+	bool push(uint8_t id, uint8_t pipe, const uint8_t *data, uint8_t n)
+	{
+		if (count == N)
+			flush();
+		if (count == N)
+		{
+			dropped++;
+			return false;
+		}
+		R &r = ring[(head + count++) % N];
+		r.radio = id;
+		r.pipe = pipe;
+		r.length = n;
+		r.flags = 0;
+		std::memcpy(r.payload, data, n);
+		return true;
+	}
+
+	/*
+	 * Send queued records without blocking. Returns the number of records
+	 * completed, -1 on a socket error other than EAGAIN (see errno).
+	 */
+	int flush()
+	{
+		if (count == 0)
+			return 0;
+		for (unsigned i = 0; i < count; i++)
+		{
+			R &r = ring[(head + i) % N];
+			iov[i].iov_base = &r;
+			iov[i].iov_len = R::HEADER + r.length;
+		}
+		int done = stream ? flushStream() : flushDatagram();
+		if (done > 0)
+		{
+			head = (head + done) % N;
+			count -= done;
+			sent += done;
+		}
+		return done;
+	}
+
+	/* Records waiting for the socket */
+	unsigned pending() const
+	{
+		return count;
+	}
+
+	int fd;
+	bool stream;
+	uint64_t sent;
+	uint64_t dropped;
+	uint8_t source;  // radio id recorded by handler()
+
+private:
+	int flushDatagram()
+	{
+		for (unsigned i = 0; i < count; i++)
+		{
+			std::memset(&msg[i], 0, sizeof(msg[i]));
+			msg[i].msg_hdr.msg_iov = &iov[i];
+			msg[i].msg_hdr.msg_iovlen = 1;
+		}
+		int n = sendmmsg(fd, msg, count, MSG_DONTWAIT);
+		if (n < 0)
+			return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+		return n;
+	}
+
+	/* The head record may have been written partially by the last call */
+	int flushStream()
+	{
+		iov[0].iov_base = (uint8_t *)iov[0].iov_base + partial;
+		iov[0].iov_len -= partial;
+		struct msghdr m;
+		std::memset(&m, 0, sizeof(m));
+		m.msg_iov = iov;
+		m.msg_iovlen = count < IOV_MAX ? count : IOV_MAX;
+		ssize_t n = sendmsg(fd, &m, MSG_DONTWAIT | MSG_NOSIGNAL);  /* writev() without SIGPIPE */
+		if (n < 0)
+			return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+		int done = 0;
+		size_t left = (size_t)n;
+		while (done < (int)m.msg_iovlen && left >= iov[done].iov_len)
+			left -= iov[done++].iov_len;
+		partial = done == 0 ? partial + left : left;
+		return done;
+	}
+
+	R ring[N];
+	unsigned head, count;
+	size_t partial;  // bytes of the head record already written
+	struct iovec iov[N];
+	struct mmsghdr msg[N];
+};
+
+#endif
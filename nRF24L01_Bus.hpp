@@ -0,0 +1,225 @@
+/*
+ * name:        nRF24L01+
+ * description: Single Chip 2.4GHz Transceiver
+ * manuf:       Nordic Semiconductor
+ * version:     0.1
+ * url:         https://www.nordicsemi.com/eng/content/download/2726/34069/file/nRF24L01P_Product_Specification_1_0.pdf
+ * date:        2017-12-19
+ * author       https://chisl.io/
+ * file:        nRF24L01_Bus.hpp
+ */
+
+#ifndef NRF24L01_BUS_HPP
+#define NRF24L01_BUS_HPP
+
+#include "nRF24L01_.hpp"
+#include <pthread.h>
+
+/*
+ * Priority arbitration of one SPI bus shared by several radios and threads
+ * (POSIX). Each priority level has its own condition variable and waiter
+ * count; when the bus is released it is handed to the highest level with
+ * waiters, and a new request never overtakes a waiter of higher priority.
+ * So an RX drain waits for at most the transaction in progress, not for a
+ * queue of register polls.
+ *
+ * nRF24L01_SharedRadio wraps the transport of one radio and holds the bus
+ * for each call at its fixed priority. nRF24L01_BusScope holds the bus at
+ * another priority across a sequence of calls by one thread, e.g. a whole
+ * service() drain, so they go out back to back without arbitration in
+ * between. The bus is reentrant for the owning thread, so calls inside the
+ * scope pass without waiting and the scope changes nothing that other
+ * threads using the same radio see.
+ *
+ * Adjacent register accesses are not merged into one chip select cycle:
+ * R_REGISTER and W_REGISTER address exactly one register and the chip
+ * does not advance to the next address, so every register
+ * needs its own CSN cycle. What can be saved is the arbitration between
+ * them, which is what nRF24L01_BusScope is for, e.g. around
+ * readRegisters() or a snapshot restore.
+ */
+class nRF24L01_Bus
+{
+public:
+	/* Priorities, lower is more urgent */
+	struct PRIORITY
+	{
+		static const uint8_t IRQ = 0;  // draining the RX FIFO, reading STATUS after an IRQ
+		static const uint8_t TX = 1;  // loading the TX FIFO
+		static const uint8_t CONFIG = 2;  // register configuration
+		static const uint8_t TELEMETRY = 3;  // polls of OBSERVE_TX, RPD, FIFO_STATUS
+		static const uint8_t LEVELS = 4;
+	};
+
+	nRF24L01_Bus() : busy(false), depth(0)
+	{
+		pthread_mutex_init(&mutex, 0);
+		for (uint8_t i = 0; i < PRIORITY::LEVELS; i++)
+		{
+			pthread_cond_init(&wake[i], 0);
+			waiting[i] = 0;
+			waits[i] = 0;
+		}
+	}
+
+	~nRF24L01_Bus()
+	{
+		for (uint8_t i = 0; i < PRIORITY::LEVELS; i++)
+			pthread_cond_destroy(&wake[i]);
+		pthread_mutex_destroy(&mutex);
+	}
+
+	void acquire(uint8_t priority)
+	{
+		if (priority >= PRIORITY::LEVELS)
+			priority = PRIORITY::LEVELS - 1;
+		pthread_mutex_lock(&mutex);
+		if (busy && pthread_equal(owner, pthread_self()))
+		{
+			depth++;
+			pthread_mutex_unlock(&mutex);
+			return;
+		}
+		if (busy || urgent(priority))
+		{
+			waits[priority]++;
+			waiting[priority]++;
+			while (busy || urgent(priority))
+				pthread_cond_wait(&wake[priority], &mutex);
+			waiting[priority]--;
+		}
+		busy = true;
+		owner = pthread_self();
+		depth = 1;
+		pthread_mutex_unlock(&mutex);
+	}
+
+	void release()
+	{
+		pthread_mutex_lock(&mutex);
+		if (--depth == 0)
+		{
+			busy = false;
+			for (uint8_t i = 0; i < PRIORITY::LEVELS; i++)
+				if (waiting[i])
+				{
+					pthread_cond_signal(&wake[i]);
+					break;
+				}
+		}
+		pthread_mutex_unlock(&mutex);
+	}
+
+	uint64_t waits[PRIORITY::LEVELS];  // acquisitions that had to wait, per priority
+
+private:
+	/* A waiter of higher priority than priority exists */
+	bool urgent(uint8_t priority) const
+	{
+		for (uint8_t i = 0; i < priority; i++)
+			if (waiting[i])
+				return true;
+		return false;
+	}
+
+	pthread_mutex_t mutex;
+	pthread_cond_t wake[PRIORITY::LEVELS];
+	uint32_t waiting[PRIORITY::LEVELS];
+	bool busy;
+	pthread_t owner;
+	uint32_t depth;  // nested acquisitions of owner
+};
+
+
+/* Transport decorator that arbitrates every call on a shared bus */
+class nRF24L01_SharedRadio : public nRF24L01_Base
+{
+public:
+	nRF24L01_SharedRadio(nRF24L01_Base &inner, nRF24L01_Bus &bus, uint8_t priority=nRF24L01_Bus::PRIORITY::CONFIG)
+		: inner(inner), bus(bus), priority(priority) {}
+
+	uint8_t read8(uint16_t address, uint16_t n=8)
+	{
+		bus.acquire(priority);
+		uint8_t value = inner.read8(address, n);
+		bus.release();
+		return value;
+	}
+
+	void write(uint16_t address, uint8_t value, uint16_t n=8)
+	{
+		bus.acquire(priority);
+		inner.write(address, value, n);
+		bus.release();
+	}
+
+	uint64_t read64(uint16_t address, uint16_t n=64)
+	{
+		bus.acquire(priority);
+		uint64_t value = inner.read64(address, n);
+		bus.release();
+		return value;
+	}
+
+	void write(uint16_t address, uint64_t value, uint16_t n=64)
+	{
+		bus.acquire(priority);
+		inner.write(address, value, n);
+		bus.release();
+	}
+
+	uint8_t command(uint8_t cmd, const uint8_t *tx, uint8_t *rx, uint16_t n)
+	{
+		bus.acquire(priority);
+		uint8_t status = inner.command(cmd, tx, rx, n);
+		bus.release();
+		return status;
+	}
+
+	uint8_t readDynamicPayload(uint8_t *buffer)
+	{
+		bus.acquire(priority);
+		uint8_t n = inner.readDynamicPayload(buffer);
+		bus.release();
+		return n;
+	}
+
+	void ce(bool level)
+	{
+		inner.ce(level);
+	}
+
+	void delayUs(uint32_t us)
+	{
+		inner.delayUs(us);
+	}
+
+	nRF24L01_Base &inner;
+	nRF24L01_Bus &bus;
+	const uint8_t priority;  // used by calls outside a nRF24L01_BusScope
+};
+
+
+/* Holds the bus at a priority for the lifetime of the scope, for the calling thread only */
+class nRF24L01_BusScope
+{
+public:
+	nRF24L01_BusScope(nRF24L01_SharedRadio &radio, uint8_t priority)
+		: bus(radio.bus)
+	{
+		bus.acquire(priority);
+	}
+
+	~nRF24L01_BusScope()
+	{
+		bus.release();
+	}
+
+private:
+	nRF24L01_BusScope(const nRF24L01_BusScope &);
+	nRF24L01_BusScope &operator=(const nRF24L01_BusScope &);
+
+	nRF24L01_Bus &bus;
+};
+
+#endif
@@ -0,0 +1,424 @@
+/*
+ * name:        nRF24L01+
+ * description: Single Chip 2.4GHz Transceiver
+ * manuf:       Nordic Semiconductor
+ * version:     0.1
+ * url:         https://www.nordicsemi.com/eng/content/download/2726/34069/file/nRF24L01P_Product_Specification_1_0.pdf
+ * date:        2017-12-19
+ * author       https://chisl.io/
+ * file:        nRF24L01_Capture.hpp
+ */
+
+#ifndef NRF24L01_CAPTURE_HPP
+#define NRF24L01_CAPTURE_HPP
+
+#include "nRF24L01_.hpp"
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+ * Packet capture file. nRF24L01_CaptureWriter appends fixed 48 byte records
+ * to a memory mapped file, growing it in steps of GROW records, so record i
+ * is at a known offset. A sidecar file (path + ".idx") holds one entry per
+ * block of BLOCK records with its time range and a bitmap of the channels
+ * in it. nRF24L01_CaptureReader maps both, finds a time by binary search
+ * over the index and skips blocks without a wanted channel.
+ *
+ * Records are expected in time order. Blocks past the end of the index
+ * (after a crash) are still readable, only without the index.
+ */
+
+/* One captured frame */
+struct nRF24L01_CaptureRecord
+{
+	struct FLAGS
+	{
+		static const uint8_t TX = 0x01;  // transmitted, received otherwise
+		static const uint8_t NOACK = 0x02;
+		static const uint8_t MAX_RT = 0x04;
+	};
+
+	uint64_t time;  // us
+	uint8_t radio;
+	uint8_t channel;  // RF_CH
+	uint8_t pipe;
+	uint8_t flags;
+	uint8_t observe;  // OBSERVE_TX
+	uint8_t length;
+	uint16_t reserved;
+	uint8_t payload[nRF24L01_Base::PAYLOAD_MAX];
+};
+
+/* File header */
+struct nRF24L01_CaptureFile
+{
+	static const uint32_t MAGIC = 0x4346524E;  // "NRFC"
+	static const uint32_t VERSION = 1;
+
+	uint32_t magic;
+	uint32_t version;
+	uint32_t recordSize;
+	uint32_t reserved;
+	uint64_t count;
+};
+
+/* Sidecar index entry */
+struct nRF24L01_CaptureIndex
+{
+	static const uint32_t BLOCK = 256;  // records per entry
+
+	uint64_t first;  // time of the first and last record
+	uint64_t last;
+	uint64_t channels[2];  // bit c: channel c occurs
+
+	void clear()
+	{
+		first = last = 0;
+		channels[0] = channels[1] = 0;
+	}
+
+	void add(const nRF24L01_CaptureRecord &r)
+	{
+		if (channels[0] == 0 && channels[1] == 0)
+			first = r.time;
+		last = r.time;
+		channels[(r.channel >> 6) & 1] |= 1ull << (r.channel & 63);
+	}
+
+	bool has(uint8_t channel) const
+	{
+		return (channels[(channel >> 6) & 1] >> (channel & 63)) & 1;
+	}
+};
+
+
+/* Appending writer */
+class nRF24L01_CaptureWriter
+{
+public:
+	typedef nRF24L01_CaptureRecord Record;
+	typedef nRF24L01_CaptureIndex Index;
+
+	static const uint32_t GROW = 65536;  // records
+
+	nRF24L01_CaptureWriter() : file(0), capacity(0), fd(-1), indexFd(-1) {}
+	~nRF24L01_CaptureWriter() { close(); }
+
+	/*
+	 * Create path, or append to it if it is a capture file. Returns false on
+	 * error; files created by the failed call are removed again.
+	 */
+	bool open(const char *path)
+	{
+		close();
+		char indexPath[PATH_MAX];
+		if (std::snprintf(indexPath, sizeof(indexPath), "%s.idx", path) >= (int)sizeof(indexPath))
+			return false;
+		bool created = false, indexCreated = false;
+		fd = create(path, created);
+		struct stat st;
+		if (fd < 0 || fstat(fd, &st) != 0)
+			return fail(path, created, indexPath, indexCreated);
+		uint64_t count = 0;
+		if ((size_t)st.st_size >= sizeof(nRF24L01_CaptureFile))
+		{
+			nRF24L01_CaptureFile h;
+			if (pread(fd, &h, sizeof(h), 0) != (ssize_t)sizeof(h) || h.magic != nRF24L01_CaptureFile::MAGIC
+				|| h.version != nRF24L01_CaptureFile::VERSION || h.recordSize != sizeof(Record))
+				return fail(path, created, indexPath, indexCreated);
+			count = h.count;
+		}
+		indexFd = create(indexPath, indexCreated);
+		if (indexFd < 0 || !map(count + GROW))
+			return fail(path, created, indexPath, indexCreated);
+		file->magic = nRF24L01_CaptureFile::MAGIC;
+		file->version = nRF24L01_CaptureFile::VERSION;
+		file->recordSize = sizeof(Record);
+		file->reserved = 0;
+		file->count = count;
+
+		/* drop the entry of a partial last block and rebuild it */
+		uint64_t blocks = count / Index::BLOCK;
+		if (ftruncate(indexFd, blocks * sizeof(Index)) != 0)
+			return fail(path, created, indexPath, indexCreated);
+		block.clear();
+		for (uint64_t i = blocks * Index::BLOCK; i < count; i++)
+			block.add(records()[i]);
+		return true;
+	}
+
+	/* Flush the partial index block, trim the file and unmap it */
+	void close()
+	{
+		if (file)
+		{
+			uint64_t count = file->count;
+			if (count % Index::BLOCK)
+				writeIndex(count / Index::BLOCK);
+			munmap(file, bytes(capacity));
+			int trimmed = ftruncate(fd, bytes(count));  /* the header count stays authoritative if this fails */
+			(void)trimmed;
+		}
+		if (fd >= 0)
+			::close(fd);
+		if (indexFd >= 0)
+			::close(indexFd);
+		file = 0;
+		capacity = 0;
+		fd = indexFd = -1;
+	}
+
+	/* Returns false if the file is not open or cannot grow */
+	bool append(const Record &r)
+	{
+		if (!file)
+			return false;
+		uint64_t count = file->count;
+		if (count == capacity && !map(capacity + GROW))
+			return false;
+		records()[count] = r;
+		block.add(r);
+		file->count = count + 1;
+		if ((count + 1) % Index::BLOCK == 0)
+		{
+			writeIndex(count / Index::BLOCK);
+			block.clear();
+		}
+		return true;
+	}
+
+	/*
+	 * Append a frame. channel (RF_CH) and observe (OBSERVE_TX) come from the
+	 * caller, which already knows the channel it set and reads OBSERVE_TX
+	 * once per TX result, so capturing costs no SPI transactions.
+	 */
+	bool capture(uint8_t radioId, uint64_t time, uint8_t channel, uint8_t pipe, uint8_t flags, uint8_t observe, const uint8_t *data, uint8_t n)
+	{
+		Record r;
+		std::memset(&r, 0, sizeof(r));
+		r.time = time;
+		r.radio = radioId;
+		r.channel = channel & nRF24L01_Base::RF_CH::RF_CH_::mask;
+		r.pipe = pipe;
+		r.flags = flags;
+		r.observe = observe;
+		r.length = n > nRF24L01_Base::PAYLOAD_MAX ? nRF24L01_Base::PAYLOAD_MAX : n;
+		std::memcpy(r.payload, data, r.length);
+		return append(r);
+	}
+
+	uint64_t size() const
+	{
+		return file ? file->count : 0;
+	}
+
+private:
+	static size_t bytes(uint64_t records)
+	{
+		return sizeof(nRF24L01_CaptureFile) + records * sizeof(Record);
+	}
+
+	Record *records()
+	{
+		return (Record *)(file + 1);
+	}
+
+	/* Open path for writing, created tells whether this call created it */
+	static int create(const char *path, bool &created)
+	{
+		int f = ::open(path, O_RDWR | O_CREAT | O_EXCL, 0644);
+		created = f >= 0;
+		return created ? f : ::open(path, O_RDWR);
+	}
+
+	/* Close and remove the files open() created, returns false */
+	bool fail(const char *path, bool created, const char *indexPath, bool indexCreated)
+	{
+		if (file)
+		{
+			munmap(file, bytes(capacity));
+			file = 0;
+			capacity = 0;
+		}
+		close();
+		if (created)
+			unlink(path);
+		if (indexCreated)
+			unlink(indexPath);
+		return false;
+	}
+
+	/* Grow the file to newCapacity records and map it again */
+	bool map(uint64_t newCapacity)
+	{
+		if (file)
+			munmap(file, bytes(capacity));
+		file = 0;
+		void *m = MAP_FAILED;
+		if (ftruncate(fd, bytes(newCapacity)) == 0)
+			m = mmap(0, bytes(newCapacity), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if (m == MAP_FAILED)
+		{
+			close();
+			return false;
+		}
+		file = (nRF24L01_CaptureFile *)m;
+		capacity = newCapacity;
+		return true;
+	}
+
+	/* A missing entry only costs lookup speed, the reader scans such blocks */
+	bool writeIndex(uint64_t entry)
+	{
+		return pwrite(indexFd, &block, sizeof(block), entry * sizeof(Index)) == (ssize_t)sizeof(block);
+	}
+
+	nRF24L01_CaptureFile *file;
+	uint64_t capacity;  // records the mapping holds
+	int fd, indexFd;
+	Index block;  // entry of the block being filled
+};
+
+
+/* Indexed reader */
+class nRF24L01_CaptureReader
+{
+public:
+	typedef nRF24L01_CaptureRecord Record;
+	typedef nRF24L01_CaptureIndex Index;
+
+	nRF24L01_CaptureReader() : records(0), count(0), index(0), entries(0), map(0), bytes(0), indexMap(0), indexBytes(0) {}
+	~nRF24L01_CaptureReader() { close(); }
+
+	/* Map path and its index, returns false if it is not a capture file */
+	bool open(const char *path)
+	{
+		close();
+		map = mapFile(path, bytes);
+		if (!map || bytes < sizeof(nRF24L01_CaptureFile))
+		{
+			close();
+			return false;
+		}
+		const nRF24L01_CaptureFile *file = (const nRF24L01_CaptureFile *)map;
+		if (file->magic != nRF24L01_CaptureFile::MAGIC || file->version != nRF24L01_CaptureFile::VERSION
+			|| file->recordSize != sizeof(Record) || sizeof(*file) + file->count * sizeof(Record) > bytes)
+		{
+			close();
+			return false;
+		}
+		records = (const Record *)(file + 1);
+		count = file->count;
+
+		char indexPath[PATH_MAX];
+		if (std::snprintf(indexPath, sizeof(indexPath), "%s.idx", path) < (int)sizeof(indexPath))
+			indexMap = mapFile(indexPath, indexBytes);
+		if (indexMap)
+		{
+			index = (const Index *)indexMap;
+			entries = indexBytes / sizeof(Index);
+			if (entries > (count + Index::BLOCK - 1) / Index::BLOCK)
+				entries = (count + Index::BLOCK - 1) / Index::BLOCK;
+		}
+		return true;
+	}
+
+	void close()
+	{
+		if (map)
+			munmap(map, bytes);
+		if (indexMap)
+			munmap(indexMap, indexBytes);
+		map = indexMap = 0;
+		records = 0;
+		index = 0;
+		count = entries = 0;
+	}
+
+	uint64_t size() const
+	{
+		return count;
+	}
+
+	const Record &operator[](uint64_t i) const
+	{
+		return records[i];
+	}
+
+	/* First record at or after time, size() if none */
+	uint64_t seek(uint64_t time) const
+	{
+		uint64_t lo = 0, hi = entries;
+		while (lo < hi)  /* first block ending at or after time */
+		{
+			uint64_t mid = lo + (hi - lo) / 2;
+			if (index[mid].last < time)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		uint64_t first = lo * Index::BLOCK;
+		uint64_t end = lo < entries && first + Index::BLOCK < count ? first + Index::BLOCK : count;
+		while (first < end)
+		{
+			uint64_t mid = first + (end - first) / 2;
+			if (records[mid].time < time)
+				first = mid + 1;
+			else
+				end = mid;
+		}
+		return first < count ? first : count;
+	}
+
+	/* First record at or after i on channel, size() if none */
+	uint64_t next(uint64_t i, uint8_t channel) const
+	{
+		while (i < count)
+		{
+			uint64_t b = i / Index::BLOCK;
+			uint64_t end = (b + 1) * Index::BLOCK < count ? (b + 1) * Index::BLOCK : count;
+			if (b < entries && !index[b].has(channel))
+			{
+				i = end;
+				continue;
+			}
+			for (; i < end; i++)
+				if (records[i].channel == channel)
+					return i;
+		}
+		return count;
+	}
+
+private:
+	static void *mapFile(const char *path, size_t &size)
+	{
+		int fd = ::open(path, O_RDONLY);
+		if (fd < 0)
+			return 0;
+		struct stat st;
+		void *m = MAP_FAILED;
+		if (fstat(fd, &st) == 0 && st.st_size > 0)
+		{
+			size = st.st_size;
+			m = mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		}
+		::close(fd);
+		return m == MAP_FAILED ? 0 : m;
+	}
+
+	const Record *records;
+	uint64_t count;
+	const Index *index;
+	uint64_t entries;
+	void *map;
+	size_t bytes;
+	void *indexMap;
+	size_t indexBytes;
+};
+
+#endif
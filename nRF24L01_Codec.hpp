@@ -0,0 +1,216 @@
+/*
+ * name:        nRF24L01+
+ * description: Single Chip 2.4GHz Transceiver
+ * manuf:       Nordic Semiconductor
+ * version:     0.1
+ * url:         https://www.nordicsemi.com/eng/content/download/2726/34069/file/nRF24L01P_Product_Specification_1_0.pdf
+ * date:        2017-12-19
+ * author       https://chisl.io/
+ * file:        nRF24L01_Codec.hpp
+ */
+
+#ifndef NRF24L01_CODEC_HPP
+#define NRF24L01_CODEC_HPP
+
+#include "nRF24L01_.hpp"
+#include <cstring>
+
+/*
+ * Payload codec for telemetry frames of up to SAMPLES_MAX int16_t samples.
+ * Each sample is delta coded against the same sample of the previous frame
+ * on the same pipe, zigzag mapped and Rice coded with a parameter k chosen
+ * per frame. No allocation, state is a fixed array per pipe.
+ *
+ * Payload: key << 7 | (count - 1), then seq << 4 | k as 16 bits big endian,
+ * Rice coded samples (MSB first). A key frame codes against zero so a
+ * receiver can start or resync on it; after a lost frame (seq gap) the
+ * decoder drops frames until the next key frame, which the encoder sends
+ * every KEY_INTERVAL frames. The 12 bit seq only aliases after 4096
+ * consecutive losses.
+ */
+class nRF24L01_Codec
+{
+public:
+	static const uint8_t SAMPLES_MAX = 32;
+	static const uint8_t HEADER = 3;
+	static const uint8_t KEY_INTERVAL = 16;
+	static const uint16_t SEQ_MASK = 0x0FFF;
+	static const uint8_t ESCAPE = 16;  // unary quotient at which 16 raw bits follow
+	static const uint8_t PIPES = 6;
+
+	nRF24L01_Codec()
+	{
+		std::memset(this, 0, sizeof(*this));
+	}
+
+	/*
+	 * Encode count samples for pipe into out (at most PAYLOAD_MAX bytes).
+	 * Returns the payload length, 0 if the frame does not fit; the state is
+	 * left unchanged then so the caller can send it another way.
+	 */
+	uint8_t encode(uint8_t pipe, const int16_t *samples, uint8_t count, uint8_t *out)
+	{
+		if (pipe >= PIPES || count == 0 || count > SAMPLES_MAX)
+			return 0;
+		State &s = tx[pipe];
+		bool key = s.frames % KEY_INTERVAL == 0 || s.count != count;
+		uint16_t z[SAMPLES_MAX];
+		uint32_t sum = 0;
+		for (uint8_t i = 0; i < count; i++)
+		{
+			z[i] = zigzag((int16_t)(samples[i] - (key ? 0 : s.prev[i])));
+			sum += z[i];
+		}
+		uint8_t k = 0;
+		while (k < 15 && (sum >> (k + 1)) >= count)  /* k ~ log2(mean) */
+			k++;
+
+		BitWriter bits(out + HEADER, nRF24L01_Base::PAYLOAD_MAX - HEADER);
+		for (uint8_t i = 0; i < count && bits.ok; i++)
+		{
+			uint16_t q = z[i] >> k;
+			if (q >= ESCAPE)
+			{
+				bits.put(0xFFFF, ESCAPE);
+				bits.put(z[i], 16);
+			}
+			else
+			{
+				bits.put(0xFFFF, q);
+				bits.put(0, 1);
+				bits.put(z[i], k);
+			}
+		}
+		if (!bits.ok)
+			return 0;
+		out[0] = (uint8_t)((key ? 0x80 : 0) | (count - 1));
+		out[1] = (uint8_t)(s.seq >> 4);
+		out[2] = (uint8_t)(s.seq << 4 | k);
+		s.seq = (s.seq + 1) & SEQ_MASK;
+		s.frames++;
+		s.count = count;
+		std::memcpy(s.prev, samples, count * sizeof(int16_t));
+		return (uint8_t)(HEADER + bits.bytes());
+	}
+
+	/* Decode a payload received on pipe, returns the sample count, 0 if dropped */
+	uint8_t decode(uint8_t pipe, const uint8_t *payload, uint8_t n, int16_t *samples)
+	{
+		if (pipe >= PIPES || n < HEADER)
+			return 0;
+		State &s = rx[pipe];
+		bool key = payload[0] & 0x80;
+		uint8_t count = (payload[0] & 0x3F) + 1;
+		uint16_t seq = (uint16_t)(payload[1] << 4 | payload[2] >> 4);
+		uint8_t k = payload[2] & 0x0F;
+		bool inSync = s.frames && seq == s.seq && count == s.count;
+		s.seq = (seq + 1) & SEQ_MASK;
+		if (count > SAMPLES_MAX || (!key && !inSync))
+		{
+			s.frames = 0;  /* wait for a key frame */
+			return 0;
+		}
+
+		BitReader bits(payload + HEADER, n - HEADER);
+		for (uint8_t i = 0; i < count; i++)
+		{
+			uint16_t q = 0;
+			while (q < ESCAPE && bits.get(1))
+				q++;
+			uint16_t z = q == ESCAPE ? (uint16_t)bits.get(16) : (uint16_t)(q << k | bits.get(k));
+			samples[i] = (int16_t)((key ? 0 : s.prev[i]) + unzigzag(z));
+		}
+		if (!bits.ok)
+		{
+			s.frames = 0;
+			return 0;
+		}
+		s.frames++;
+		s.count = count;
+		std::memcpy(s.prev, samples, count * sizeof(int16_t));
+		return count;
+	}
+
+private:
+	struct State
+	{
+		int16_t prev[SAMPLES_MAX];
+		uint32_t frames;
+		uint8_t count;
+		uint16_t seq;
+	};
+
+	/* MSB first bit writer over a fixed array */
+	struct BitWriter
+	{
+		uint8_t *p;
+		uint16_t cap, pos;  // bits
+		bool ok;
+
+		BitWriter(uint8_t *p, uint8_t bytes) : p(p), cap(bytes * 8), pos(0), ok(true) {}
+
+		void put(uint32_t v, uint8_t n)
+		{
+			if (pos + n > cap)
+			{
+				ok = false;
+				return;
+			}
+			while (n--)
+			{
+				uint8_t mask = 0x80 >> (pos & 7);
+				if ((v >> n) & 1)
+					p[pos >> 3] |= mask;
+				else
+					p[pos >> 3] &= ~mask;
+				pos++;
+			}
+		}
+
+		uint8_t bytes() const
+		{
+			return (uint8_t)((pos + 7) / 8);
+		}
+	};
+
+	/* MSB first bit reader over a received payload */
+	struct BitReader
+	{
+		const uint8_t *p;
+		uint16_t cap, pos;  // bits
+		bool ok;
+
+		BitReader(const uint8_t *p, uint8_t bytes) : p(p), cap(bytes * 8), pos(0), ok(true) {}
+
+		uint32_t get(uint8_t n)
+		{
+			uint32_t v = 0;
+			if (pos + n > cap)
+			{
+				ok = false;
+				return 0;
+			}
+			while (n--)
+			{
+				v = v << 1 | ((p[pos >> 3] >> (7 - (pos & 7))) & 1);
+				pos++;
+			}
+			return v;
+		}
+	};
+
+	static uint16_t zigzag(int16_t v)
+	{
+		return (uint16_t)(((uint16_t)v << 1) ^ (uint16_t)(v >> 15));
+	}
+
+	static int16_t unzigzag(uint16_t z)
+	{
+		return (int16_t)((z >> 1) ^ (uint16_t)-(int16_t)(z & 1));
+	}
+
+	State tx[PIPES];
+	State rx[PIPES];
+};
+
+#endif
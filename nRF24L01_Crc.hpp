@@ -0,0 +1,120 @@
+/*
+ * name:        nRF24L01+
+ * description: Single Chip 2.4GHz Transceiver
+ * manuf:       Nordic Semiconductor
+ * version:     0.1
+ * url:         https://www.nordicsemi.com/eng/content/download/2726/34069/file/nRF24L01P_Product_Specification_1_0.pdf
+ * date:        2017-12-19
+ * author       https://chisl.io/
+ * file:        nRF24L01_Crc.hpp
+ */
+
+#ifndef NRF24L01_CRC_HPP
+#define NRF24L01_CRC_HPP
+
+#include "nRF24L01_.hpp"
+#include <cstddef>
+
+/*
+ * The packet CRC as computed by the chip (see 7.3.5): CONFIG::CRCO 1 is
+ * CRC-16 with polynomial 0x1021, CRCO 0 is CRC-8 with polynomial 0x07, both
+ * initialized to all ones, not reflected, no final XOR, over the bits of
+ * address, packet control field and payload in air order (MSB first).
+ *
+ * Whole bytes go through lookup tables, slicing by 8 for CRC-16; the 9 bit
+ * packet control field is fed with the bit functions, after which the
+ * payload bytes use the tables again. Tables are built on first use.
+ */
+class nRF24L01_Crc
+{
+public:
+	static const uint16_t POLY16 = 0x1021;
+	static const uint16_t INIT16 = 0xFFFF;
+	static const uint8_t POLY8 = 0x07;
+	static const uint8_t INIT8 = 0xFF;
+
+	static uint16_t crc16(uint16_t crc, const uint8_t *data, size_t n)
+	{
+		const Tables &t = tables();
+		for (; n >= 8; n -= 8, data += 8)
+			crc = t.t16[7][(crc >> 8) ^ data[0]] ^ t.t16[6][(crc & 0xFF) ^ data[1]]
+				^ t.t16[5][data[2]] ^ t.t16[4][data[3]] ^ t.t16[3][data[4]]
+				^ t.t16[2][data[5]] ^ t.t16[1][data[6]] ^ t.t16[0][data[7]];
+		while (n--)
+			crc = (uint16_t)(crc << 8) ^ t.t16[0][(crc >> 8) ^ *data++];
+		return crc;
+	}
+
+	/* Feed the low count bits of bits, MSB first */
+	static uint16_t crc16Bits(uint16_t crc, uint32_t bits, uint8_t count)
+	{
+		while (count--)
+		{
+			bool top = ((crc >> 15) ^ (bits >> count)) & 1;
+			crc = (uint16_t)(crc << 1) ^ (top ? POLY16 : 0);
+		}
+		return crc;
+	}
+
+	static uint8_t crc8(uint8_t crc, const uint8_t *data, size_t n)
+	{
+		const Tables &t = tables();
+		while (n--)
+			crc = t.t8[crc ^ *data++];
+		return crc;
+	}
+
+	static uint8_t crc8Bits(uint8_t crc, uint32_t bits, uint8_t count)
+	{
+		while (count--)
+		{
+			bool top = ((crc >> 7) ^ (bits >> count)) & 1;
+			crc = (uint8_t)(crc << 1) ^ (top ? POLY8 : 0);
+		}
+		return crc;
+	}
+
+	/*
+	 * CRC of a frame as the chip computes it, crcBytes 1 or 2. address holds
+	 * aw bytes in air order, pcf the 9 bit packet control field.
+	 */
+	static uint16_t frame(uint8_t crcBytes, const uint8_t *address, uint8_t aw, uint16_t pcf, const uint8_t *payload, uint8_t n)
+	{
+		if (crcBytes == 1)
+		{
+			uint8_t crc = crc8(INIT8, address, aw);
+			crc = crc8Bits(crc, pcf, 9);
+			return crc8(crc, payload, n);
+		}
+		uint16_t crc = crc16(INIT16, address, aw);
+		crc = crc16Bits(crc, pcf, 9);
+		return crc16(crc, payload, n);
+	}
+
+private:
+	struct Tables
+	{
+		uint16_t t16[8][256];  // t16[k][x]: CRC of byte x followed by k zero bytes
+		uint8_t t8[256];
+
+		Tables()
+		{
+			for (unsigned x = 0; x < 256; x++)
+			{
+				t16[0][x] = crc16Bits(0, x, 8);
+				t8[x] = crc8Bits(0, x, 8);
+			}
+			for (unsigned k = 1; k < 8; k++)
+				for (unsigned x = 0; x < 256; x++)
+					t16[k][x] = (uint16_t)(t16[k - 1][x] << 8) ^ t16[0][t16[k - 1][x] >> 8];
+		}
+	};
+
+	static const Tables &tables()
+	{
+		static const Tables t;
+		return t;
+	}
+};
+
+#endif
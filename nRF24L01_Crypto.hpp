@@ -0,0 +1,308 @@
+/*
+ * name:        nRF24L01+
+ * description: Single Chip 2.4GHz Transceiver
+ * manuf:       Nordic Semiconductor
+ * version:     0.1
+ * url:         https://www.nordicsemi.com/eng/content/download/2726/34069/file/nRF24L01P_Product_Specification_1_0.pdf
+ * date:        2017-12-19
+ * author       https://chisl.io/
+ * file:        nRF24L01_Crypto.hpp
+ */
+
+#ifndef NRF24L01_CRYPTO_HPP
+#define NRF24L01_CRYPTO_HPP
+
+#include "nRF24L01_.hpp"
+#include <cstring>
+#ifdef __AES__
+#include <wmmintrin.h>
+#endif
+
+/*
+ * Authenticated encryption of payloads with AES-128 in CCM mode (RFC 3610,
+ * L = 2). Only the AES forward cipher is needed. Built with -maes the
+ * block cipher runs on AES-NI, otherwise on a portable byte oriented
+ * implementation. Nothing is allocated, the key schedule lives in the
+ * object.
+ */
+
+/* AES-128 forward cipher */
+class nRF24L01_Aes128
+{
+public:
+	static const uint8_t BLOCK = 16;
+	static const uint8_t ROUNDS = 10;
+
+	explicit nRF24L01_Aes128(const uint8_t key[16])
+	{
+		expand(key);
+	}
+
+	void expand(const uint8_t key[16])
+	{
+		std::memcpy(rk, key, 16);
+		uint8_t rcon = 0x01;
+		for (uint8_t i = 16; i < sizeof(rk); i += 4)
+		{
+			uint8_t t[4] = { rk[i - 4], rk[i - 3], rk[i - 2], rk[i - 1] };
+			if (i % 16 == 0)
+			{
+				uint8_t t0 = t[0];
+				t[0] = sub(t[1]) ^ rcon;
+				t[1] = sub(t[2]);
+				t[2] = sub(t[3]);
+				t[3] = sub(t0);
+				rcon = xtime(rcon);
+			}
+			for (uint8_t j = 0; j < 4; j++)
+				rk[i + j] = rk[i + j - 16] ^ t[j];
+		}
+	}
+
+	/* Encrypt one block, in and out may alias */
+	void encrypt(const uint8_t in[16], uint8_t out[16]) const
+	{
+#ifdef __AES__
+		__m128i b = _mm_xor_si128(_mm_loadu_si128((const __m128i *)in), _mm_loadu_si128((const __m128i *)rk));
+		for (uint8_t r = 1; r < ROUNDS; r++)
+			b = _mm_aesenc_si128(b, _mm_loadu_si128((const __m128i *)(rk + 16 * r)));
+		b = _mm_aesenclast_si128(b, _mm_loadu_si128((const __m128i *)(rk + 16 * ROUNDS)));
+		_mm_storeu_si128((__m128i *)out, b);
+#else
+		uint8_t s[16], t[16];
+		for (uint8_t i = 0; i < 16; i++)
+			s[i] = in[i] ^ rk[i];
+		for (uint8_t r = 1; r <= ROUNDS; r++)
+		{
+			/* SubBytes and ShiftRows, state is column major */
+			for (uint8_t c = 0; c < 4; c++)
+				for (uint8_t row = 0; row < 4; row++)
+					t[4 * c + row] = sub(s[4 * ((c + row) & 3) + row]);
+			if (r < ROUNDS)
+				for (uint8_t c = 0; c < 16; c += 4)  /* MixColumns */
+				{
+					uint8_t a0 = t[c], a1 = t[c + 1], a2 = t[c + 2], a3 = t[c + 3], x = a0 ^ a1 ^ a2 ^ a3;
+					t[c] ^= x ^ xtime(a0 ^ a1);
+					t[c + 1] ^= x ^ xtime(a1 ^ a2);
+					t[c + 2] ^= x ^ xtime(a2 ^ a3);
+					t[c + 3] ^= x ^ xtime(a3 ^ a0);
+				}
+			for (uint8_t i = 0; i < 16; i++)
+				s[i] = t[i] ^ rk[16 * r + i];
+		}
+		std::memcpy(out, s, 16);
+#endif
+	}
+
+private:
+	static uint8_t xtime(uint8_t x)
+	{
+		return (uint8_t)(x << 1 ^ (x & 0x80 ? 0x1B : 0));
+	}
+
+	static uint8_t sub(uint8_t x)
+	{
+		static const uint8_t SBOX[256] = {
+			0x63, 0x7C, 0x77, 0x7B, 0xF2, 0x6B, 0x6F, 0xC5, 0x30, 0x01, 0x67, 0x2B, 0xFE, 0xD7, 0xAB, 0x76,
+			0xCA, 0x82, 0xC9, 0x7D, 0xFA, 0x59, 0x47, 0xF0, 0xAD, 0xD4, 0xA2, 0xAF, 0x9C, 0xA4, 0x72, 0xC0,
+			0xB7, 0xFD, 0x93, 0x26, 0x36, 0x3F, 0xF7, 0xCC, 0x34, 0xA5, 0xE5, 0xF1, 0x71, 0xD8, 0x31, 0x15,
+			0x04, 0xC7, 0x23, 0xC3, 0x18, 0x96, 0x05, 0x9A, 0x07, 0x12, 0x80, 0xE2, 0xEB, 0x27, 0xB2, 0x75,
+			0x09, 0x83, 0x2C, 0x1A, 0x1B, 0x6E, 0x5A, 0xA0, 0x52, 0x3B, 0xD6, 0xB3, 0x29, 0xE3, 0x2F, 0x84,
+			0x53, 0xD1, 0x00, 0xED, 0x20, 0xFC, 0xB1, 0x5B, 0x6A, 0xCB, 0xBE, 0x39, 0x4A, 0x4C, 0x58, 0xCF,
+			0xD0, 0xEF, 0xAA, 0xFB, 0x43, 0x4D, 0x33, 0x85, 0x45, 0xF9, 0x02, 0x7F, 0x50, 0x3C, 0x9F, 0xA8,
+			0x51, 0xA3, 0x40, 0x8F, 0x92, 0x9D, 0x38, 0xF5, 0xBC, 0xB6, 0xDA, 0x21, 0x10, 0xFF, 0xF3, 0xD2,
+			0xCD, 0x0C, 0x13, 0xEC, 0x5F, 0x97, 0x44, 0x17, 0xC4, 0xA7, 0x7E, 0x3D, 0x64, 0x5D, 0x19, 0x73,
+			0x60, 0x81, 0x4F, 0xDC, 0x22, 0x2A, 0x90, 0x88, 0x46, 0xEE, 0xB8, 0x14, 0xDE, 0x5E, 0x0B, 0xDB,
+			0xE0, 0x32, 0x3A, 0x0A, 0x49, 0x06, 0x24, 0x5C, 0xC2, 0xD3, 0xAC, 0x62, 0x91, 0x95, 0xE4, 0x79,
+			0xE7, 0xC8, 0x37, 0x6D, 0x8D, 0xD5, 0x4E, 0xA9, 0x6C, 0x56, 0xF4, 0xEA, 0x65, 0x7A, 0xAE, 0x08,
+			0xBA, 0x78, 0x25, 0x2E, 0x1C, 0xA6, 0xB4, 0xC6, 0xE8, 0xDD, 0x74, 0x1F, 0x4B, 0xBD, 0x8B, 0x8A,
+			0x70, 0x3E, 0xB5, 0x66, 0x48, 0x03, 0xF6, 0x0E, 0x61, 0x35, 0x57, 0xB9, 0x86, 0xC1, 0x1D, 0x9E,
+			0xE1, 0xF8, 0x98, 0x11, 0x69, 0xD9, 0x8E, 0x94, 0x9B, 0x1E, 0x87, 0xE9, 0xCE, 0x55, 0x28, 0xDF,
+			0x8C, 0xA1, 0x89, 0x0D, 0xBF, 0xE6, 0x42, 0x68, 0x41, 0x99, 0x2D, 0x0F, 0xB0, 0x54, 0xBB, 0x16,
+		};
+		return SBOX[x];
+	}
+
+	uint8_t rk[16 * (ROUNDS + 1)];  // round keys, byte order as in FIPS-197
+};
+
+
+/* AES-128-CCM with a 13 byte nonce (L = 2) and an M byte MIC */
+class nRF24L01_Ccm
+{
+public:
+	static const uint8_t NONCE = 13;
+
+	explicit nRF24L01_Ccm(const uint8_t key[16]) : aes(key) {}
+
+	/* Encrypt n bytes from in to out and write the M byte MIC to mic */
+	void seal(const uint8_t nonce[NONCE], const uint8_t *aad, uint8_t aadLen, const uint8_t *in, uint8_t n, uint8_t *out, uint8_t *mic, uint8_t M) const
+	{
+		uint8_t tag[16];
+		mac(nonce, aad, aadLen, in, n, M, tag);
+		ctr(nonce, in, n, out, tag, M);
+		std::memcpy(mic, tag, M);
+	}
+
+	/* Decrypt and verify, out is wiped and false returned if the MIC does not match */
+	bool open(const uint8_t nonce[NONCE], const uint8_t *aad, uint8_t aadLen, const uint8_t *in, uint8_t n, const uint8_t *mic, uint8_t *out, uint8_t M) const
+	{
+		uint8_t s0[16], tag[16];
+		std::memcpy(s0, mic, M);
+		ctr(nonce, in, n, out, s0, M);  /* s0 now holds the decrypted MIC */
+		mac(nonce, aad, aadLen, out, n, M, tag);
+		uint8_t diff = 0;
+		for (uint8_t i = 0; i < M; i++)  /* constant time compare */
+			diff |= tag[i] ^ s0[i];
+		if (diff)
+			std::memset(out, 0, n);
+		return diff == 0;
+	}
+
+private:
+	/* CBC-MAC over B0, the encoded associated data and the message */
+	void mac(const uint8_t nonce[NONCE], const uint8_t *aad, uint8_t aadLen, const uint8_t *in, uint8_t n, uint8_t M, uint8_t x[16]) const
+	{
+		x[0] = (uint8_t)((aadLen ? 0x40 : 0) | ((M - 2) / 2) << 3 | 1);
+		std::memcpy(x + 1, nonce, NONCE);
+		x[14] = 0;
+		x[15] = n;
+		aes.encrypt(x, x);
+		if (aadLen)
+		{
+			uint8_t block[16] = { 0, aadLen };
+			uint8_t used = 2;
+			for (uint8_t i = 0; i < aadLen; i++)
+			{
+				block[used++] = aad[i];
+				if (used == 16)
+				{
+					absorb(x, block, 16);
+					used = 0;
+				}
+			}
+			if (used)
+				absorb(x, block, used);
+		}
+		for (uint8_t i = 0; i < n; i += 16)
+			absorb(x, in + i, n - i < 16 ? n - i : 16);
+	}
+
+	void absorb(uint8_t x[16], const uint8_t *block, uint8_t n) const
+	{
+		for (uint8_t i = 0; i < n; i++)
+			x[i] ^= block[i];
+		aes.encrypt(x, x);
+	}
+
+	/* CTR mode: A0 keystream onto the M bytes of tag, A1.. onto the message */
+	void ctr(const uint8_t nonce[NONCE], const uint8_t *in, uint8_t n, uint8_t *out, uint8_t tag[16], uint8_t M) const
+	{
+		uint8_t a[16], s[16];
+		a[0] = 1;
+		std::memcpy(a + 1, nonce, NONCE);
+		a[14] = 0;
+		for (uint8_t block = 0; block == 0 || (block - 1) * 16 < n; block++)
+		{
+			a[15] = block;
+			aes.encrypt(a, s);
+			if (block == 0)
+			{
+				for (uint8_t i = 0; i < M; i++)
+					tag[i] ^= s[i];
+				continue;
+			}
+			uint8_t offset = (block - 1) * 16;
+			for (uint8_t i = 0; i < 16 && offset + i < n; i++)
+				out[offset + i] = in[offset + i] ^ s[i];
+		}
+	}
+
+	nRF24L01_Aes128 aes;
+};
+
+
+/* Frame layout */
+struct nRF24L01_SecureFrame
+{
+	static const uint8_t COUNTER = 4;  // little endian, in clear
+	static const uint8_t MIC = 4;
+	static const uint8_t OVERHEAD = COUNTER + MIC;
+	static const uint8_t PAYLOAD_MAX = nRF24L01_Base::PAYLOAD_MAX - OVERHEAD;
+};
+
+/*
+ * Encrypted link between two addresses sharing a key. The nonce is the
+ * sender's 5 byte address followed by its frame counter, so both
+ * directions can use one key without reusing a nonce. Received counters
+ * must increase, which rejects replayed frames; hardware retransmissions
+ * of one frame are already filtered by the PID.
+ *
+ * Both counters must survive restarts: a reset txCounter reuses nonces
+ * (and breaks CCM), a reset rxCounter accepts replays. Persist them before
+ * use, e.g. by writing txCounter + BLOCK to flash and starting from the
+ * stored value after a restart, so one write covers BLOCK frames; frames
+ * received with a counter below the stored rxCounter are then rejected.
+ */
+class nRF24L01_SecureLink
+{
+public:
+	typedef nRF24L01_SecureFrame F;
+
+	/* txCounter, rxCounter: values persisted by the application, 0 only for a new key */
+	nRF24L01_SecureLink(const uint8_t key[16], uint64_t local, uint64_t peer, uint32_t txCounter, uint32_t rxCounter)
+		: ccm(key), local(local), peer(peer), txCounter(txCounter), rxCounter(rxCounter), rejected(0) {}
+
+	/* Encrypt n bytes into frame, returns the frame length, 0 if too long or the counter is exhausted */
+	uint8_t seal(const uint8_t *buffer, uint8_t n, uint8_t *frame)
+	{
+		if (n > F::PAYLOAD_MAX || txCounter == 0xFFFFFFFF)
+			return 0;
+		uint8_t nonce[nRF24L01_Ccm::NONCE];
+		uint32_t counter = txCounter++;
+		makeNonce(local, counter, nonce);
+		for (uint8_t i = 0; i < F::COUNTER; i++)
+			frame[i] = (uint8_t)(counter >> (8 * i));
+		ccm.seal(nonce, 0, 0, buffer, n, frame + F::COUNTER, frame + F::COUNTER + n, F::MIC);
+		return n + F::OVERHEAD;
+	}
+
+	/* Verify and decrypt frame into buffer, false if forged, corrupted or replayed */
+	bool open(const uint8_t *frame, uint8_t n, uint8_t *buffer, uint8_t &length)
+	{
+		if (n < F::OVERHEAD)
+		{
+			rejected++;
+			return false;
+		}
+		uint32_t counter = frame[0] | frame[1] << 8 | frame[2] << 16 | (uint32_t)frame[3] << 24;
+		uint8_t nonce[nRF24L01_Ccm::NONCE];
+		makeNonce(peer, counter, nonce);
+		length = n - F::OVERHEAD;
+		if (counter < rxCounter || counter == 0xFFFFFFFF || !ccm.open(nonce, 0, 0, frame + F::COUNTER, length, frame + F::COUNTER + length, buffer, F::MIC))
+		{
+			rejected++;
+			return false;
+		}
+		rxCounter = counter + 1;
+		return true;
+	}
+
+	nRF24L01_Ccm ccm;
+	uint64_t local, peer;  // 5 byte addresses
+	uint32_t txCounter;  // next counter to send, persist it
+	uint32_t rxCounter;  // lowest counter accepted next, persist it
+	uint32_t rejected;
+
+private:
+	static void makeNonce(uint64_t address, uint32_t counter, uint8_t nonce[nRF24L01_Ccm::NONCE])
+	{
+		std::memset(nonce, 0, nRF24L01_Ccm::NONCE);
+		for (uint8_t i = 0; i < 5; i++)
+			nonce[i] = (uint8_t)(address >> (8 * i));
+		for (uint8_t i = 0; i < 4; i++)
+			nonce[5 + i] = (uint8_t)(counter >> (8 * i));
+	}
+};
+
+#endif
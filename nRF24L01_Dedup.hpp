@@ -0,0 +1,119 @@
+/*
+ * name:        nRF24L01+
+ * description: Single Chip 2.4GHz Transceiver
+ * manuf:       Nordic Semiconductor
+ * version:     0.1
+ * url:         https://www.nordicsemi.com/eng/content/download/2726/34069/file/nRF24L01P_Product_Specification_1_0.pdf
+ * date:        2017-12-19
+ * author       https://chisl.io/
+ * file:        nRF24L01_Dedup.hpp
+ */
+
+#ifndef NRF24L01_DEDUP_HPP
+#define NRF24L01_DEDUP_HPP
+
+#include "nRF24L01_.hpp"
+#include <cstring>
+
+/*
+ * Receive side duplicate filter. When the ACK of a packet is lost the PTX
+ * sends it again with the same PID; the PRX discards it only if it still
+ * holds the previous PID and CRC of that pipe (see 7.5.2), which fails once
+ * other traffic came in between or after a reset. The PID itself is not
+ * visible to the MCU, so packets are keyed by the application sequence
+ * number at payload byte seqOffset together with a 32 bit FNV-1a hash of
+ * length and payload; both must match for a duplicate.
+ *
+ * Each pipe keeps the last D keys in a fixed ring. A key seen again within
+ * windowUs of its first arrival is a duplicate; the window should cover
+ * the retransmit time, (ARC + 1) * ARD. It is not extended by further
+ * copies, so a sender repeating a payload and sequence number is only
+ * suppressed for one window.
+ */
+template<uint8_t D=8>
+class nRF24L01_Dedup
+{
+public:
+	static const uint8_t PIPES = 6;
+	static const uint8_t NO_SEQUENCE = 0xFF;  // seqOffset of payloads without a sequence number, hash only
+
+	nRF24L01_Dedup(uint32_t windowUs, uint8_t seqOffset)
+		: windowUs(windowUs), seqOffset(seqOffset), now(0), duplicates(0), deliver(0), context(0)
+	{
+		std::memset(entry, 0, sizeof(entry));
+		std::memset(used, 0, sizeof(used));
+		std::memset(next, 0, sizeof(next));
+	}
+
+	/* True if the payload was seen on pipe within the window, records it otherwise */
+	bool duplicate(uint8_t pipe, const uint8_t *data, uint8_t n, uint32_t now)
+	{
+		if (pipe >= PIPES)
+			return false;
+		uint32_t key = hash(data, n);
+		uint8_t seq = seqOffset < n ? data[seqOffset] : 0;
+		for (uint8_t i = 0; i < used[pipe]; i++)
+		{
+			Entry &e = entry[pipe][i];
+			if (e.key == key && e.seq == seq && now - e.at < windowUs)
+			{
+				duplicates++;
+				return true;
+			}
+		}
+		Entry &e = entry[pipe][next[pipe]];
+		e.key = key;
+		e.at = now;
+		e.seq = seq;
+		next[pipe] = (next[pipe] + 1) % D;
+		if (used[pipe] < D)
+			used[pipe]++;
+		return false;
+	}
+
+	/* Forward non-duplicates to deliver, for use as a filter in front of another handler */
+	void chain(nRF24L01_ReceiveHandler deliver, void *context=0)
+	{
+		this->deliver = deliver;
+		this->context = context;
+	}
+
+	/* nRF24L01_ReceiveHandler for nRF24L01_Base::service(), context is the filter; set now before */
+	static void handler(void *context, uint8_t pipe, const uint8_t *data, uint8_t n)
+	{
+		nRF24L01_Dedup *d = static_cast<nRF24L01_Dedup *>(context);
+		if (!d->duplicate(pipe, data, n, d->now) && d->deliver)
+			d->deliver(d->context, pipe, data, n);
+	}
+
+	uint32_t windowUs;
+	uint8_t seqOffset;
+	uint32_t now;  // us, timestamp used by handler()
+	uint32_t duplicates;
+
+private:
+	struct Entry
+	{
+		uint32_t key;
+		uint32_t at;  // first arrival
+		uint8_t seq;
+	};
+
+	/* FNV-1a over length and payload */
+	static uint32_t hash(const uint8_t *data, uint8_t n)
+	{
+		uint32_t h = 2166136261u;
+		h = (h ^ n) * 16777619u;
+		for (uint8_t i = 0; i < n; i++)
+			h = (h ^ data[i]) * 16777619u;
+		return h;
+	}
+
+	Entry entry[PIPES][D];
+	uint8_t used[PIPES];
+	uint8_t next[PIPES];
+	nRF24L01_ReceiveHandler deliver;
+	void *context;
+};
+
+#endif
@@ -0,0 +1,140 @@
+/*
+ * name:        nRF24L01+
+ * description: Single Chip 2.4GHz Transceiver
+ * manuf:       Nordic Semiconductor
+ * version:     0.1
+ * url:         https://www.nordicsemi.com/eng/content/download/2726/34069/file/nRF24L01P_Product_Specification_1_0.pdf
+ * date:        2017-12-19
+ * author       https://chisl.io/
+ * file:        nRF24L01_Esb.hpp
+ */
+
+#ifndef NRF24L01_ESB_HPP
+#define NRF24L01_ESB_HPP
+
+#include "nRF24L01_.hpp"
+#include "nRF24L01_Crc.hpp"
+#include <cstring>
+
+/*
+ * On-air Enhanced ShockBurst frames (see 7.3): preamble, address of 3 to 5
+ * bytes, 9 bit packet control field (6 bit length, 2 bit PID, NO_ACK),
+ * payload and a 0, 1 or 2 byte CRC, MSB first. The address is given as the
+ * register value (RX_ADDR_Px, TX_ADDR) and sent MSByte first.
+ *
+ * The control field leaves payload and CRC one bit off byte alignment; they
+ * are shifted in a single loop over independent bytes that the compiler
+ * can vectorize.
+ */
+
+/* Decoded frame */
+struct nRF24L01_EsbPacket
+{
+	uint64_t address;
+	uint8_t length;
+	uint8_t pid;
+	bool noAck;
+	bool valid;  // length in range and CRC matched
+	uint8_t payload[nRF24L01_Base::PAYLOAD_MAX];
+};
+
+class nRF24L01_Esb
+{
+public:
+	typedef nRF24L01_EsbPacket P;
+
+	static const uint8_t PREAMBLE_ONE = 0xAA;  // address starts with a 1 bit
+	static const uint8_t PREAMBLE_ZERO = 0x55;
+	static const uint8_t PCF_BITS = 9;
+	static const uint8_t FRAME_MAX = 1 + 5 + 2 + nRF24L01_Base::PAYLOAD_MAX + 2;  // bytes
+
+	/* Frame length in bits, the preamble is one byte at every data rate */
+	static uint16_t bits(uint8_t aw, uint8_t n, uint8_t crcBytes)
+	{
+		return 8 * (1 + aw + n + crcBytes) + PCF_BITS;
+	}
+
+	/*
+	 * Encode p with aw address bytes and crcBytes (0, 1 or 2) of CRC into out,
+	 * which needs FRAME_MAX bytes. Returns the frame length in bits; unused
+	 * bits of the last byte are 0.
+	 */
+	static uint16_t encode(const P &p, uint8_t aw, uint8_t crcBytes, uint8_t *out)
+	{
+		uint8_t n = p.length > nRF24L01_Base::PAYLOAD_MAX ? nRF24L01_Base::PAYLOAD_MAX : p.length;
+		for (uint8_t i = 0; i < aw; i++)
+			out[1 + i] = (uint8_t)(p.address >> (8 * (aw - 1 - i)));
+		out[0] = out[1] & 0x80 ? PREAMBLE_ONE : PREAMBLE_ZERO;
+		uint16_t pcf = (uint16_t)(n << 3 | (p.pid & 3) << 1 | (p.noAck ? 1 : 0));
+		uint16_t crc = crcBytes ? nRF24L01_Crc::frame(crcBytes, out + 1, aw, pcf, p.payload, n) : 0;
+
+		uint8_t tail[nRF24L01_Base::PAYLOAD_MAX + 2];
+		std::memcpy(tail, p.payload, n);
+		if (crcBytes == 1)
+			tail[n] = (uint8_t)crc;
+		else if (crcBytes == 2)
+		{
+			tail[n] = (uint8_t)(crc >> 8);
+			tail[n + 1] = (uint8_t)crc;
+		}
+		uint8_t m = n + crcBytes;
+
+		uint8_t *o = out + 1 + aw;
+		o[0] = (uint8_t)(pcf >> 1);
+		if (m == 0)  /* empty payload without CRC: the frame ends with the control field */
+		{
+			o[1] = (uint8_t)((pcf & 1) << 7);
+			return bits(aw, 0, 0);
+		}
+		o[1] = (uint8_t)((pcf & 1) << 7 | tail[0] >> 1);
+		for (uint8_t i = 1; i < m; i++)
+			o[1 + i] = (uint8_t)(tail[i - 1] << 7 | tail[i] >> 1);
+		o[1 + m] = (uint8_t)(tail[m - 1] << 7);
+		return bits(aw, n, crcBytes);
+	}
+
+	/*
+	 * Decode a frame starting at the preamble. payloadWidth 0 takes the length
+	 * from the control field (dynamic payload), otherwise it is the static
+	 * RX_PW_Px width. nbits is the number of valid bits in frame. Returns
+	 * p.valid.
+	 */
+	static bool decode(const uint8_t *frame, uint16_t nbits, uint8_t aw, uint8_t crcBytes, uint8_t payloadWidth, P &p)
+	{
+		p.valid = false;
+		if (nbits < bits(aw, 0, crcBytes))
+			return false;
+		p.address = 0;
+		for (uint8_t i = 0; i < aw; i++)
+			p.address = p.address << 8 | frame[1 + i];
+		const uint8_t *in = frame + 1 + aw;
+		uint16_t pcf = (uint16_t)(in[0] << 1 | in[1] >> 7);
+		p.length = payloadWidth ? payloadWidth : (uint8_t)(pcf >> 3);
+		p.pid = (pcf >> 1) & 3;
+		p.noAck = pcf & 1;
+		if (p.length > nRF24L01_Base::PAYLOAD_MAX || nbits < bits(aw, p.length, crcBytes))
+			return false;
+
+		uint8_t tail[nRF24L01_Base::PAYLOAD_MAX + 2];
+		uint8_t m = p.length + crcBytes;
+		for (uint8_t i = 0; i < m; i++)
+			tail[i] = (uint8_t)(in[1 + i] << 1 | in[2 + i] >> 7);
+		std::memcpy(p.payload, tail, p.length);
+		if (crcBytes == 0)
+			return p.valid = true;
+		uint16_t crc = crcBytes == 1 ? tail[p.length] : (uint16_t)(tail[p.length] << 8 | tail[p.length + 1]);
+		p.valid = crc == nRF24L01_Crc::frame(crcBytes, frame + 1, aw, pcf, p.payload, p.length);
+		return p.valid;
+	}
+
+	/* Decode count frames stored stride bytes apart with nbits[i] valid bits each, returns the number valid */
+	static size_t decode(const uint8_t *frames, size_t stride, const uint16_t *nbits, size_t count, uint8_t aw, uint8_t crcBytes, uint8_t payloadWidth, P *packets)
+	{
+		size_t valid = 0;
+		for (size_t i = 0; i < count; i++)
+			valid += decode(frames + i * stride, nbits[i], aw, crcBytes, payloadWidth, packets[i]);
+		return valid;
+	}
+};
+
+#endif
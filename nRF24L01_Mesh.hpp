@@ -0,0 +1,344 @@
+/*
+ * name:        nRF24L01+
+ * description: Single Chip 2.4GHz Transceiver
+ * manuf:       Nordic Semiconductor
+ * version:     0.1
+ * url:         https://www.nordicsemi.com/eng/content/download/2726/34069/file/nRF24L01P_Product_Specification_1_0.pdf
+ * date:        2017-12-19
+ * author       https://chisl.io/
+ * file:        nRF24L01_Mesh.hpp
+ */
+
+#ifndef NRF24L01_MESH_HPP
+#define NRF24L01_MESH_HPP
+
+#include "nRF24L01_.hpp"
+#include <cstring>
+
+/*
+ * Multi-hop mesh with distance vector routing. Node ids are 8 bit; a node
+ * listens on pipe 1 to (prefix << 8 | id) and on pipe 2 to the broadcast id
+ * 0xFF, so all nodes of a mesh share the upper address bytes as pipes 2 to 5
+ * require. Link cost is an ETX estimate in 1/16 transmissions, updated from
+ * OBSERVE_TX::ARC_CNT after every unicast and counted as 16 retransmissions
+ * on MAX_RT. Routes are learnt from periodic no-ack adverts, which carry
+ * the next hop of each route; a route whose next hop is the receiver is
+ * taken as unreachable (split horizon with poisoned reverse), so two nodes
+ * do not keep a lost destination alive through each other.
+ *
+ * Frames to the same next hop are kept in the 3 deep TX FIFO together, so
+ * forwarding is pipelined; frames to another hop wait in a fixed queue of Q
+ * frames until the FIFO has drained. On MAX_RT the FIFO is flushed and
+ * the failed frame and those loaded behind it count as dropped.
+ */
+
+/* Frame layout */
+struct nRF24L01_MeshFrame
+{
+	static const uint8_t DATA = 0xB0;  // DATA, dst, src, ttl, payload
+	static const uint8_t ADVERT = 0xB1;  // ADVERT, BROADCAST, src, 0, (dst, cost, next hop) triples
+	static const uint8_t HEADER = 4;
+	static const uint8_t PAYLOAD_MAX = nRF24L01_Base::PAYLOAD_MAX - HEADER;
+	static const uint8_t BROADCAST = 0xFF;
+	static const uint8_t TTL = 8;
+};
+
+/* Routing table, indexed directly by destination id */
+struct nRF24L01_RoutingTable
+{
+	static const uint8_t UNREACHABLE = 0xFF;
+	static const uint8_t ETX_ONE = 16;  // cost of a perfect link
+
+	uint8_t hop[256];
+	uint8_t cost[256];
+	uint8_t age[256];  // ticks since the route was last confirmed
+
+	nRF24L01_RoutingTable()
+	{
+		std::memset(hop, 0, sizeof(hop));
+		std::memset(cost, UNREACHABLE, sizeof(cost));
+		std::memset(age, 0, sizeof(age));
+	}
+
+	/* Take the route if it is new, cheaper, or an update from the current next hop */
+	bool update(uint8_t dst, uint8_t via, unsigned newCost)
+	{
+		if (newCost >= UNREACHABLE)
+			newCost = UNREACHABLE;
+		if (newCost < cost[dst] || hop[dst] == via)
+		{
+			hop[dst] = via;
+			cost[dst] = (uint8_t)newCost;
+			age[dst] = 0;
+			return true;
+		}
+		return false;
+	}
+
+	/* Drop routes not confirmed for maxAge ticks */
+	void expire(uint8_t maxAge)
+	{
+		for (unsigned i = 0; i < 256; i++)
+			if (cost[i] != UNREACHABLE && ++age[i] > maxAge)
+				cost[i] = UNREACHABLE;
+	}
+};
+
+
+template<uint8_t Q=8>
+class nRF24L01_Mesh
+{
+public:
+	typedef nRF24L01_Base B;
+	typedef nRF24L01_MeshFrame F;
+	typedef nRF24L01_RoutingTable T;
+
+	static const uint8_t MAX_AGE = 4;  // advert periods a route survives without refresh
+
+	/* prefix: upper 4 address bytes shared by the mesh, deliver: payloads for this node */
+	nRF24L01_Mesh(nRF24L01_Base &radio, uint32_t prefix, uint8_t id, nRF24L01_ReceiveHandler deliver, void *context=0)
+		: radio(radio), prefix(prefix), id(id), deliver(deliver), context(context), dropped(0), idle(true), hop(F::BROADCAST), loaded(0), head(0), count(0)
+	{
+		std::memset(link, T::ETX_ONE * 2, sizeof(link));
+		table.update(id, id, 0);
+	}
+
+	/* Set up addresses and pipes 1 (unicast) and 2 (broadcast), then listen; false if id is BROADCAST */
+	bool begin()
+	{
+		if (id == F::BROADCAST)
+			return false;
+		config = radio.getCONFIG() & ~B::CONFIG::PRIM_RX::mask;
+		radio.setRX_ADDR_P0(address(id));
+		radio.setRX_ADDR_P1(address(id));
+		radio.write(B::RX_ADDR_P2::__address, F::BROADCAST, 8);
+		radio.setEN_RXADDR(radio.getEN_RXADDR() | B::EN_RXADDR::ERX_P1::mask | B::EN_RXADDR::ERX_P2::mask);
+		radio.setEN_AA((radio.getEN_AA() | B::EN_AA::ENAA_P1::mask) & ~B::EN_AA::ENAA_P2::mask);
+		radio.setFEATURE(radio.getFEATURE() | B::FEATURE::EN_DYN_ACK::mask);
+		receiveMode();
+		return true;
+	}
+
+	uint64_t address(uint8_t node) const
+	{
+		return (uint64_t)prefix << 8 | node;
+	}
+
+	/* Send payload to dst, false if there is no route or the queue is full */
+	bool send(uint8_t dst, const uint8_t *buffer, uint8_t n)
+	{
+		if (n > F::PAYLOAD_MAX)
+			return false;
+		uint8_t frame[B::PAYLOAD_MAX];
+		frame[0] = F::DATA;
+		frame[1] = dst;
+		frame[2] = id;
+		frame[3] = F::TTL;
+		std::memcpy(frame + F::HEADER, buffer, n);
+		return forward(frame, n + F::HEADER);
+	}
+
+	/* nRF24L01_ReceiveHandler for nRF24L01_Base::service(), context is the mesh */
+	static void handler(void *context, uint8_t pipe, const uint8_t *data, uint8_t n)
+	{
+		(void)pipe;
+		static_cast<nRF24L01_Mesh *>(context)->onFrame(data, n);
+	}
+
+	void onFrame(const uint8_t *frame, uint8_t n)
+	{
+		if (n < F::HEADER)
+			return;
+		if (frame[0] == F::ADVERT)
+			onAdvert(frame, n);
+		else if (frame[0] == F::DATA && frame[1] == id)
+			deliver(context, frame[2], frame + F::HEADER, n - F::HEADER);
+		else if (frame[0] == F::DATA && frame[3] > 1)
+		{
+			uint8_t copy[B::PAYLOAD_MAX];
+			std::memcpy(copy, frame, n);
+			copy[3]--;
+			if (!forward(copy, n))
+				dropped++;
+		}
+	}
+
+	/*
+	 * Call with the TX_DS / MAX_RT flags returned by service(). Updates the
+	 * cost of the current next hop, loads queued frames and returns to
+	 * listening once the TX FIFO is empty.
+	 */
+	void onTxResult(uint8_t flags)
+	{
+		if (idle || !(flags & (B::STATUS::TX_DS::mask | B::STATUS::MAX_RT::mask)))
+			return;
+		if (hop != F::BROADCAST)
+		{
+			unsigned tries = flags & B::STATUS::MAX_RT::mask ? 16 : (radio.getOBSERVE_TX() & B::OBSERVE_TX::ARC_CNT::mask) + 1;
+			unsigned etx = (link[hop] * 7u + tries * T::ETX_ONE) / 8;
+			link[hop] = etx > 0xFF ? 0xFF : (uint8_t)etx;
+			if (flags & B::STATUS::MAX_RT::mask)
+			{
+				if ((flags & B::STATUS::TX_DS::mask) && loaded)
+					loaded--;  /* one frame went out before the failed one */
+				dropped += loaded;  /* the failed frame and those behind it */
+				loaded = 0;
+				radio.flushTx();
+			}
+		}
+		if (!(radio.getFIFO_STATUS() & B::FIFO_STATUS::TX_EMPTY::mask))
+		{
+			if (loaded > 1)
+				loaded--;
+			return;
+		}
+		loaded = 0;
+		idle = true;
+		pump();
+		if (idle)
+			receiveMode();
+	}
+
+	/* Call once per advert period: ages routes and broadcasts this node's table */
+	void tick()
+	{
+		table.expire(MAX_AGE);
+		table.update(id, id, 0);
+		uint8_t frame[B::PAYLOAD_MAX];
+		frame[0] = F::ADVERT;
+		frame[1] = F::BROADCAST;
+		frame[2] = id;
+		frame[3] = 0;
+		uint8_t n = F::HEADER;
+		for (unsigned dst = 0; dst < 256; dst++)
+		{
+			if (table.cost[dst] == T::UNREACHABLE)
+				continue;
+			if (n + 3 > B::PAYLOAD_MAX)
+			{
+				advert(frame, n);
+				n = F::HEADER;
+			}
+			frame[n++] = (uint8_t)dst;
+			frame[n++] = table.cost[dst];
+			frame[n++] = table.hop[dst];
+		}
+		advert(frame, n);
+	}
+
+	nRF24L01_Base &radio;
+	uint32_t prefix;
+	uint8_t id;
+	nRF24L01_ReceiveHandler deliver;
+	void *context;
+	T table;
+	uint8_t link[256];  // ETX of the link to each neighbour
+	uint32_t dropped;
+
+private:
+	struct Slot
+	{
+		uint8_t frame[B::PAYLOAD_MAX];
+		uint8_t n;
+	};
+
+	void onAdvert(const uint8_t *frame, uint8_t n)
+	{
+		uint8_t from = frame[2];
+		if (from == id)
+			return;
+		table.update(from, from, link[from]);
+		for (uint8_t i = F::HEADER; i + 2 < n; i += 3)
+			if (frame[i] != id)
+				table.update(frame[i], from, frame[i + 2] == id ? T::UNREACHABLE : frame[i + 1] + (unsigned)link[from]);
+	}
+
+	void advert(const uint8_t *frame, uint8_t n)
+	{
+		if (!idle && hop != F::BROADCAST)
+			return;  /* unicast frames in the FIFO, skip this advert */
+		if (idle)
+		{
+			transmitMode(F::BROADCAST);
+			hop = F::BROADCAST;
+		}
+		if (!(radio.writeTxPayloadNoAck(frame, n) & B::STATUS::TX_FULL::mask))
+			loaded++;
+	}
+
+	/* PTX to next, CE stays high so loaded frames go out back to back */
+	void transmitMode(uint8_t next)
+	{
+		radio.ce(false);
+		radio.setCONFIG(config);
+		radio.setTX_ADDR(address(next));
+		radio.setRX_ADDR_P0(address(next));  /* ACK arrives on pipe 0 */
+		radio.ce(true);
+		idle = false;
+	}
+
+	/* PRX, pipe 0 back on this node's address so it does not overhear */
+	void receiveMode()
+	{
+		radio.ce(false);
+		radio.setRX_ADDR_P0(address(id));
+		radio.setCONFIG(config | B::CONFIG::PRIM_RX::mask);
+		radio.ce(true);
+	}
+
+	/* Load frame into the TX FIFO if it goes to the hop already loaded, queue it otherwise */
+	bool forward(const uint8_t *frame, uint8_t n)
+	{
+		uint8_t dst = frame[1];
+		if (table.cost[dst] == T::UNREACHABLE)
+			return false;
+		uint8_t next = table.hop[dst];
+		if (count == 0 && load(next, frame, n))
+			return true;
+		if (count == Q)
+			return false;
+		Slot &s = queue[(head + count++) % Q];
+		std::memcpy(s.frame, frame, n);
+		s.n = n;
+		return true;
+	}
+
+	bool load(uint8_t next, const uint8_t *frame, uint8_t n)
+	{
+		if (!idle && hop != next)
+			return false;
+		if (idle)
+		{
+			transmitMode(next);
+			hop = next;
+		}
+		if (radio.writeTxPayload(frame, n) & B::STATUS::TX_FULL::mask)
+			return false;
+		loaded++;
+		return true;
+	}
+
+	void pump()
+	{
+		while (count)
+		{
+			Slot &s = queue[head];
+			uint8_t dst = s.frame[1];
+			if (table.cost[dst] == T::UNREACHABLE)
+				dropped++;
+			else if (!load(table.hop[dst], s.frame, s.n))
+				return;
+			head = (head + 1) % Q;
+			count--;
+		}
+	}
+
+	uint8_t config;  // CONFIG without PRIM_RX
+	bool idle;  // TX FIFO empty, listening
+	uint8_t hop;  // next hop of the frames in the TX FIFO, BROADCAST for adverts
+	uint8_t loaded;  // frames in the TX FIFO
+	Slot queue[Q];
+	uint8_t head, count;
+};
+
+#endif
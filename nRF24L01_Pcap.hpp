@@ -0,0 +1,199 @@
+/*
+ * name:        nRF24L01+
+ * description: Single Chip 2.4GHz Transceiver
+ * manuf:       Nordic Semiconductor
+ * version:     0.1
+ * url:         https://www.nordicsemi.com/eng/content/download/2726/34069/file/nRF24L01P_Product_Specification_1_0.pdf
+ * date:        2017-12-19
+ * author       https://chisl.io/
+ * file:        nRF24L01_Pcap.hpp
+ */
+
+#ifndef NRF24L01_PCAP_HPP
+#define NRF24L01_PCAP_HPP
+
+#include "nRF24L01_.hpp"
+#include "nRF24L01_Capture.hpp"
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+/*
+ * Streaming pcapng writer. Frames are written as Enhanced Packet Blocks
+ * with link type LINKTYPE_USER0; each radio configuration is an interface
+ * whose if_description names channel, data rate and address width, so
+ * Wireshark shows them without a dissector. Packet data is a 4 byte pseudo
+ * header (RF_CH, pipe, nRF24L01_CaptureRecord::FLAGS, OBSERVE_TX) followed
+ * by the payload. Timestamps are us.
+ *
+ * Blocks are assembled in a fixed buffer of BUFFER bytes and written with
+ * one write() when it fills, so memory use does not grow with the capture.
+ */
+template<unsigned BUFFER=65536>
+class nRF24L01_PcapWriter
+{
+public:
+	typedef nRF24L01_Base B;
+
+	static const uint16_t LINKTYPE = 147;  // LINKTYPE_USER0
+	static const uint8_t PSEUDO_HEADER = 4;
+
+	/* Block types and options */
+	struct PCAPNG
+	{
+		static const uint32_t SHB = 0x0A0D0D0A;
+		static const uint32_t IDB = 0x00000001;
+		static const uint32_t EPB = 0x00000006;
+		static const uint32_t BYTE_ORDER_MAGIC = 0x1A2B3C4D;
+		static const uint16_t OPT_END = 0;
+		static const uint16_t IF_DESCRIPTION = 3;
+		static const uint16_t IF_TSRESOL = 9;
+	};
+
+	nRF24L01_PcapWriter() : frames(0), fd(-1), used(0), interfaces(0), ok(false) {}
+	~nRF24L01_PcapWriter() { close(); }
+
+	/* Create path and write the section header, false on error */
+	bool open(const char *path)
+	{
+		close();
+		fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		ok = fd >= 0;
+		interfaces = 0;
+		frames = 0;
+		put32(PCAPNG::SHB);
+		put32(28);
+		put32(PCAPNG::BYTE_ORDER_MAGIC);
+		put16(1);  /* version 1.0 */
+		put16(0);
+		put32(0xFFFFFFFF);  /* section length unknown */
+		put32(0xFFFFFFFF);
+		put32(28);
+		return ok;
+	}
+
+	/* Describe an interface, returns its id for write(), -1 on error */
+	int addInterface(uint8_t channel, uint16_t rateKbps, uint8_t aw)
+	{
+		char description[64];
+		int n = std::snprintf(description, sizeof(description), "nRF24L01+ channel %u (%u MHz), %u kbps, %u byte address",
+			channel, 2400u + channel, rateKbps, aw);
+		uint32_t padded = (n + 3) & ~3u;
+		uint32_t length = 16 + 4 + padded + 8 + 4 + 4;
+		put32(PCAPNG::IDB);
+		put32(length);
+		put16(LINKTYPE);
+		put16(0);
+		put32(PSEUDO_HEADER + B::PAYLOAD_MAX);  /* snaplen */
+		put16(PCAPNG::IF_DESCRIPTION);
+		put16((uint16_t)n);
+		put(description, n);
+		pad(n);
+		put16(PCAPNG::IF_TSRESOL);
+		put16(1);
+		uint8_t resolution = 6;  /* 10^-6 s */
+		put(&resolution, 1);
+		pad(1);
+		put32(PCAPNG::OPT_END);
+		put32(length);
+		return ok ? (int)interfaces++ : -1;
+	}
+
+	/* Describe the current configuration of radio */
+	int addInterface(nRF24L01_Base &radio)
+	{
+		uint8_t setup = radio.getRF_SETUP();
+		uint16_t rate = setup & B::RF_SETUP::RF_DR_LOW::mask ? 250 : setup & B::RF_SETUP::RF_DR_HIGH::mask ? 2000 : 1000;
+		uint8_t aw = (radio.getSETUP_AW() & B::SETUP_AW::AW::mask) + 2;
+		return addInterface(radio.getRF_CH() & B::RF_CH::RF_CH_::mask, rate, aw);
+	}
+
+	bool write(uint32_t interface, uint64_t timeUs, uint8_t channel, uint8_t pipe, uint8_t flags, uint8_t observe, const uint8_t *data, uint8_t n)
+	{
+		if (n > B::PAYLOAD_MAX)
+			n = B::PAYLOAD_MAX;
+		uint32_t captured = PSEUDO_HEADER + n;
+		uint32_t length = 28 + ((captured + 3) & ~3u) + 4;
+		put32(PCAPNG::EPB);
+		put32(length);
+		put32(interface);
+		put32((uint32_t)(timeUs >> 32));
+		put32((uint32_t)timeUs);
+		put32(captured);
+		put32(captured);
+		uint8_t header[PSEUDO_HEADER] = { channel, pipe, flags, observe };
+		put(header, PSEUDO_HEADER);
+		put(data, n);
+		pad(captured);
+		put32(length);
+		frames++;
+		return ok;
+	}
+
+	bool write(uint32_t interface, const nRF24L01_CaptureRecord &r)
+	{
+		return write(interface, r.time, r.channel, r.pipe, r.flags, r.observe, r.payload, r.length);
+	}
+
+	/* Write out the buffer, false if any write failed so far */
+	bool flush()
+	{
+		size_t done = 0;
+		while (ok && done < used)
+		{
+			ssize_t n = ::write(fd, buffer + done, used - done);
+			if (n <= 0)
+				ok = false;
+			else
+				done += n;
+		}
+		used = 0;
+		return ok;
+	}
+
+	bool close()
+	{
+		bool result = flush();
+		if (fd >= 0)
+			::close(fd);
+		fd = -1;
+		ok = false;
+		return result;
+	}
+
+	uint64_t frames;
+
+private:
+	void put(const void *data, size_t n)
+	{
+		if (used + n > BUFFER)
+			flush();
+		std::memcpy(buffer + used, data, n);
+		used += n;
+	}
+
+	void put16(uint16_t v)
+	{
+		put(&v, 2);
+	}
+
+	void put32(uint32_t v)
+	{
+		put(&v, 4);
+	}
+
+	void pad(size_t n)
+	{
+		static const uint8_t zero[3] = { 0, 0, 0 };
+		put(zero, (4 - (n & 3)) & 3);
+	}
+
+	int fd;
+	size_t used;
+	uint32_t interfaces;
+	bool ok;
+	uint8_t buffer[BUFFER];
+};
+
+#endif
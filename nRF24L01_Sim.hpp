@@ -0,0 +1,607 @@
+/*
+ * name:        nRF24L01+
+ * description: Single Chip 2.4GHz Transceiver
+ * manuf:       Nordic Semiconductor
+ * version:     0.1
+ * url:         https://www.nordicsemi.com/eng/content/download/2726/34069/file/nRF24L01P_Product_Specification_1_0.pdf
+ * date:        2017-12-19
+ * author       https://chisl.io/
+ * file:        nRF24L01_Sim.hpp
+ */
+
+#ifndef NRF24L01_SIM_HPP
+#define NRF24L01_SIM_HPP
+
+#include "nRF24L01_.hpp"
+#include "nRF24L01_Esb.hpp"
+#include <vector>
+#include <algorithm>
+#include <cstring>
+
+/*
+ * Discrete event air simulator. Every node is a nRF24L01_SimRadio, which is a
+ * nRF24L01_Base backed by simulated registers, so driver code runs unmodified.
+ * Time is in microseconds and only advances in nRF24L01_SimAir::run(); events
+ * with equal time are processed in scheduling order, so runs are deterministic.
+ */
+
+class nRF24L01_SimAir;
+
+/* Simulated nRF24L01+ */
+class nRF24L01_SimRadio : public nRF24L01_Base
+{
+public:
+	static const uint8_t FIFO_DEPTH = 3;
+
+	/* One FIFO entry */
+	struct Packet
+	{
+		uint8_t len;
+		uint8_t pipe;
+		bool noack;
+		uint8_t data[PAYLOAD_MAX];
+	};
+
+	/* Fixed size FIFO as on the chip */
+	struct Fifo
+	{
+		Packet slot[FIFO_DEPTH];
+		uint8_t head, count;
+
+		Fifo() : head(0), count(0) {}
+		bool empty() const { return count == 0; }
+		bool full() const { return count == FIFO_DEPTH; }
+		Packet &front() { return slot[head]; }
+		Packet &push() { return slot[(head + count++) % FIFO_DEPTH]; }
+		void pop() { head = (head + 1) % FIFO_DEPTH; count--; }
+		void clear() { head = count = 0; }
+	};
+
+	nRF24L01_SimRadio(nRF24L01_SimAir &air);
+
+	/* Called on falling IRQ edge, override to run node logic */
+	virtual void irq() {}
+
+	/* Called for timers scheduled with nRF24L01_SimAir::schedule() */
+	virtual void timer(uint32_t tag) { (void)tag; }
+
+	uint8_t read8(uint16_t address, uint16_t n=8)
+	{
+		(void)n;
+		address &= 0x1F;
+		if (address == STATUS::__address)
+			return status();
+		if (address == FIFO_STATUS::__address)
+			return fifoStatus();
+		if (address == RPD::__address)
+			return (listening() ? channelBusy() : rpd) ? RPD::RPD_::mask : 0;
+		return (uint8_t)reg[address];
+	}
+
+	void write(uint16_t address, uint8_t value, uint16_t n=8)
+	{
+		(void)n;
+		address &= 0x1F;
+		if (address == STATUS::__address)
+		{
+			/* write 1 to clear, IRQ pin releases when no flag remains */
+			reg[address] &= ~(value & (STATUS::RX_DR::mask | STATUS::TX_DS::mask | STATUS::MAX_RT::mask));
+			return;
+		}
+		if (address == OBSERVE_TX::__address || address == FIFO_STATUS::__address || address == RPD::__address)
+			return;
+		if (address == RF_CH::__address)
+		{
+			reg[OBSERVE_TX::__address] &= ~OBSERVE_TX::PLOS_CNT::mask;
+			retune(value & RF_CH::RF_CH_::mask);
+		}
+		reg[address] = value;
+	}
+
+	uint64_t read64(uint16_t address, uint16_t n=64)
+	{
+		(void)n;
+		return reg[address & 0x1F];
+	}
+
+	void write(uint16_t address, uint64_t value, uint16_t n=64)
+	{
+		reg[address & 0x1F] = n < 64 ? value & ((1ull << n) - 1) : value;
+	}
+
+	uint8_t command(uint8_t cmd, const uint8_t *tx, uint8_t *rx, uint16_t n);
+	void ce(bool level);
+
+	/* Simulation state, used by nRF24L01_SimAir */
+	uint8_t channel() const { return (uint8_t)(reg[RF_CH::__address] & RF_CH::RF_CH_::mask); }
+	bool poweredUp() const { return reg[CONFIG::__address] & CONFIG::PWR_UP::mask; }
+	bool listening() const { return ceLevel && poweredUp() && (reg[CONFIG::__address] & CONFIG::PRIM_RX::mask); }
+	uint8_t addressWidth() const { return (uint8_t)((reg[SETUP_AW::__address] & SETUP_AW::AW::mask) + 2); }
+	uint8_t crcBytes() const;
+	uint32_t bitRate() const;
+	int matchPipe(uint64_t address) const;
+
+	nRF24L01_SimAir &air;
+	uint32_t id;
+	uint64_t reg[0x20];
+	bool ceLevel;
+	bool rpd;  // RPD latched when CE went low in RX
+	bool transmitting;  // packet or retransmission in flight
+	uint8_t pid;  // PID of the TX FIFO head
+	uint8_t lastPid[6];  // last received PID per pipe, to discard retransmits
+	uint32_t lastSrc[6];  // transmitter of lastPid
+	Fifo txFifo, rxFifo;
+	Packet ackPayload[6];  // W_ACK_PAYLOAD per pipe, len 0 if none
+	Packet ackIn;  // payload of the ACK in flight to this radio
+
+private:
+	bool channelBusy() const;
+	void retune(uint8_t ch);
+
+	uint8_t status() const
+	{
+		uint8_t pipe = rxFifo.empty() ? STATUS::RX_P_NO::RX_FIFO_EMPTY : const_cast<Fifo &>(rxFifo).front().pipe;
+		return (uint8_t)((reg[STATUS::__address] & (STATUS::RX_DR::mask | STATUS::TX_DS::mask | STATUS::MAX_RT::mask))
+			| (pipe << 1) | (txFifo.full() ? STATUS::TX_FULL::mask : 0));
+	}
+
+	uint8_t fifoStatus() const
+	{
+		return (txFifo.full() ? FIFO_STATUS::TX_FULL::mask : 0) | (txFifo.empty() ? FIFO_STATUS::TX_EMPTY::mask : 0)
+			| (rxFifo.full() ? FIFO_STATUS::RX_FULL::mask : 0) | (rxFifo.empty() ? FIFO_STATUS::RX_EMPTY::mask : 0);
+	}
+};
+
+
+/* Air: channels, airtime, collisions and the event queue */
+class nRF24L01_SimAir
+{
+public:
+	/* Event types */
+	struct EV
+	{
+		static const uint8_t TX_END = 0;  // packet left the transmitter
+		static const uint8_t ACK_END = 1;  // ACK left the receiver, arg: ARD remaining after it
+		static const uint8_t ACK_TIMEOUT = 2;  // ARD elapsed without ACK
+		static const uint8_t TIMER = 3;  // user timer
+	};
+
+	/* Heap entry, ordered by (time, seq) */
+	struct Event
+	{
+		uint64_t time;
+		uint32_t seq;
+		uint32_t radio;
+		uint32_t arg;
+		uint8_t type;
+
+		bool operator<(const Event &o) const  /* inverted for a min heap */
+		{
+			return time != o.time ? time > o.time : seq > o.seq;
+		}
+	};
+
+	/* Transmission currently on air */
+	struct Transmission
+	{
+		uint32_t radio;  // transmitter, for an ACK the radio it is sent to
+		uint64_t end;
+		bool ack;
+		bool collided;
+	};
+
+	/* Timing, see page 72 */
+	static const uint32_t SETTLE_US = 130;  // TX/RX settling
+
+	static const uint8_t CHANNELS = 128;
+
+	nRF24L01_SimAir() : now(0), seq(0), delivered(0), collisions(0), channels(CHANNELS), tuned(CHANNELS) {}
+
+	uint32_t attach(nRF24L01_SimRadio *radio, uint8_t ch)
+	{
+		radios.push_back(radio);
+		tuned[ch].push_back((uint32_t)(radios.size() - 1));
+		return (uint32_t)(radios.size() - 1);
+	}
+
+	/*
+	 * Keep the per channel radio index current, so delivery only visits
+	 * radios on the channel. A packet or ACK of r on air moves along,
+	 * marked collided: retuning mid-packet corrupts it.
+	 */
+	void retune(uint32_t r, uint8_t from, uint8_t to)
+	{
+		std::vector<uint32_t> &old = tuned[from];
+		old.erase(std::find(old.begin(), old.end(), r));
+		tuned[to].push_back(r);
+		std::vector<Transmission> &active = channels[from];
+		for (size_t i = 0; i < active.size(); )
+		{
+			if (active[i].radio != r)
+			{
+				i++;
+				continue;
+			}
+			Transmission t = active[i];
+			active[i] = active.back();
+			active.pop_back();
+			onAir(to, r, t.ack, t.end);
+			channels[to].back().collided = true;
+		}
+	}
+
+	void schedule(uint64_t time, uint32_t radio, uint8_t type, uint32_t arg=0)
+	{
+		Event e;
+		e.time = time;
+		e.seq = seq++;
+		e.radio = radio;
+		e.arg = arg;
+		e.type = type;
+		heap.push_back(e);
+		std::push_heap(heap.begin(), heap.end());
+	}
+
+	/* Airtime of a packet in us: preamble, address, 9 bit PCF, payload, CRC */
+	static uint32_t airtime(const nRF24L01_SimRadio &r, uint8_t payload)
+	{
+		uint32_t bits = nRF24L01_Esb::bits(r.addressWidth(), payload, r.crcBytes());
+		return (uint32_t)((uint64_t)bits * 1000000 / r.bitRate());
+	}
+
+	bool channelBusy(uint8_t ch) const
+	{
+		return !channels[ch].empty();
+	}
+
+	/* Start sending the TX FIFO head of radio r */
+	void transmit(uint32_t r)
+	{
+		nRF24L01_SimRadio &radio = *radios[r];
+		radio.transmitting = true;
+		schedule(onAir(radio.channel(), r, false, now + SETTLE_US + airtime(radio, radio.txFifo.front().len)), r, EV::TX_END);
+	}
+
+	/* Process events up to and including time limit */
+	void run(uint64_t limit)
+	{
+		while (!heap.empty() && heap.front().time <= limit)
+		{
+			std::pop_heap(heap.begin(), heap.end());
+			Event e = heap.back();
+			heap.pop_back();
+			now = e.time;
+			dispatch(e);
+		}
+		if (now < limit)
+			now = limit;
+	}
+
+	uint64_t now;
+	uint32_t seq;
+	uint64_t delivered, collisions;
+	std::vector<nRF24L01_SimRadio *> radios;
+
+private:
+	typedef nRF24L01_Base B;
+
+	void dispatch(const Event &e)
+	{
+		nRF24L01_SimRadio &radio = *radios[e.radio];
+		switch (e.type)
+		{
+		case EV::TX_END: txEnd(e.radio); break;
+		case EV::ACK_END: ackEnd(radio, e.arg); break;
+		case EV::ACK_TIMEOUT: ackTimeout(radio); break;
+		case EV::TIMER: radio.timer(e.arg); break;
+		}
+	}
+
+	/* Put a transmission on air until end, colliding with any other on the channel */
+	uint64_t onAir(uint8_t ch, uint32_t r, bool ack, uint64_t end)
+	{
+		std::vector<Transmission> &active = channels[ch];
+		Transmission t;
+		t.radio = r;
+		t.end = end;
+		t.ack = ack;
+		t.collided = !active.empty();
+		for (size_t i = 0; i < active.size(); i++)
+			active[i].collided = true;
+		active.push_back(t);
+		return end;
+	}
+
+	/* Take a transmission off air, returns true if it collided */
+	bool offAir(uint8_t ch, uint32_t r, bool ack)
+	{
+		std::vector<Transmission> &active = channels[ch];
+		for (size_t i = 0; i < active.size(); i++)
+			if (active[i].radio == r && active[i].ack == ack)
+			{
+				bool collided = active[i].collided;
+				active[i] = active.back();
+				active.pop_back();
+				return collided;
+			}
+		return false;
+	}
+
+	void txEnd(uint32_t r)
+	{
+		nRF24L01_SimRadio &tx = *radios[r];
+		bool collided = offAir(tx.channel(), r, false);
+
+		nRF24L01_SimRadio::Packet &p = tx.txFifo.front();
+		bool acked = false;
+		uint32_t ackLen = 0;
+		uint32_t ackFrom = 0;
+		if (collided)
+			collisions++;
+		else
+		{
+			uint64_t address = tx.reg[B::TX_ADDR::__address];
+			const std::vector<uint32_t> &candidates = tuned[tx.channel()];
+			for (size_t i = 0; i < candidates.size(); i++)
+			{
+				nRF24L01_SimRadio &rx = *radios[candidates[i]];
+				if (candidates[i] == r || !rx.listening() || rx.bitRate() != tx.bitRate())
+					continue;
+				int pipe = rx.matchPipe(address);
+				if (pipe < 0)
+					continue;
+				bool autoAck = !p.noack && (rx.reg[B::EN_AA::__address] & (1u << pipe));
+				if (!deliver(rx, pipe, p, tx))
+					continue;
+				if (autoAck && !acked)
+				{
+					acked = true;
+					ackFrom = candidates[i];
+					tx.ackIn = rx.ackPayload[pipe];
+					ackLen = tx.ackIn.len;
+					rx.ackPayload[pipe].len = 0;
+				}
+			}
+		}
+
+		bool wantAck = !p.noack && (tx.reg[B::SETUP_RETR::__address] & B::SETUP_RETR::ARC::mask);
+		if (!wantAck)
+			txDone(tx, B::STATUS::TX_DS::mask);
+		else if (acked)
+		{
+			/* the ACK is on air and can collide like any packet */
+			uint64_t end = onAir(tx.channel(), r, true, now + SETTLE_US + airtime(*radios[ackFrom], (uint8_t)ackLen));
+			uint32_t ard = ardUs(tx);
+			schedule(end, r, EV::ACK_END, now + ard > end ? (uint32_t)(now + ard - end) : 0);
+		}
+		else
+			schedule(now + ardUs(tx), r, EV::ACK_TIMEOUT);
+	}
+
+	/* Returns false if the packet was not accepted (RX FIFO full) */
+	bool deliver(nRF24L01_SimRadio &rx, int pipe, const nRF24L01_SimRadio::Packet &p, const nRF24L01_SimRadio &tx)
+	{
+		if (rx.rxFifo.full())
+			return false;
+		bool retransmit = tx.reg[B::OBSERVE_TX::__address] & B::OBSERVE_TX::ARC_CNT::mask;
+		if (retransmit && rx.lastPid[pipe] == tx.pid && rx.lastSrc[pipe] == tx.id)
+			return true;  /* retransmit of a packet already received, ACK only */
+		rx.lastPid[pipe] = tx.pid;
+		rx.lastSrc[pipe] = tx.id;
+		bool dynamic = rx.reg[B::DYNPD::__address] & (1u << pipe);
+		nRF24L01_SimRadio::Packet &q = rx.rxFifo.push();
+		q = p;
+		q.pipe = (uint8_t)pipe;
+		if (!dynamic)
+			q.len = (uint8_t)(rx.reg[B::RX_PW_P0::__address + pipe] & B::RX_PW_P0::RX_PW_P0_::mask);
+		raise(rx, B::STATUS::RX_DR::mask, B::CONFIG::MASK_RX_DR::mask);
+		delivered++;
+		return true;
+	}
+
+	void ackEnd(nRF24L01_SimRadio &tx, uint32_t ardLeft)
+	{
+		if (offAir(tx.channel(), tx.id, true))
+		{
+			collisions++;
+			schedule(now + ardLeft, tx.id, EV::ACK_TIMEOUT);
+			return;
+		}
+		if (tx.ackIn.len && !tx.rxFifo.full())
+		{
+			nRF24L01_SimRadio::Packet &q = tx.rxFifo.push();
+			q = tx.ackIn;
+			q.pipe = 0;
+			tx.reg[B::STATUS::__address] |= B::STATUS::RX_DR::mask;
+		}
+		txDone(tx, B::STATUS::TX_DS::mask);
+	}
+
+	void ackTimeout(nRF24L01_SimRadio &tx)
+	{
+		uint8_t observe = (uint8_t)tx.reg[B::OBSERVE_TX::__address];
+		uint8_t arc = observe & B::OBSERVE_TX::ARC_CNT::mask;
+		if (arc < (tx.reg[B::SETUP_RETR::__address] & B::SETUP_RETR::ARC::mask))
+		{
+			tx.reg[B::OBSERVE_TX::__address] = (observe & ~B::OBSERVE_TX::ARC_CNT::mask) | (arc + 1);
+			transmit(tx.id);
+			return;
+		}
+		uint8_t plos = observe >> 4;
+		if (plos < 15)
+			plos++;
+		tx.reg[B::OBSERVE_TX::__address] = (uint8_t)(plos << 4) | arc;
+		tx.transmitting = false;
+		raise(tx, B::STATUS::MAX_RT::mask, B::CONFIG::MASK_MAX_RT::mask);  /* head stays in the FIFO */
+	}
+
+	void txDone(nRF24L01_SimRadio &tx, uint8_t flag)
+	{
+		tx.txFifo.pop();
+		tx.pid = (tx.pid + 1) & 3;
+		tx.reg[B::OBSERVE_TX::__address] &= ~B::OBSERVE_TX::ARC_CNT::mask;
+		tx.transmitting = false;
+		raise(tx, flag, B::CONFIG::MASK_TX_DS::mask);
+		if (tx.ceLevel && !tx.txFifo.empty() && !tx.transmitting)
+			transmit(tx.id);
+	}
+
+	static uint32_t ardUs(const nRF24L01_SimRadio &r)
+	{
+		return 250 * (((r.reg[B::SETUP_RETR::__address] & B::SETUP_RETR::ARDa::mask) >> 4) + 1);
+	}
+
+	static void raise(nRF24L01_SimRadio &r, uint8_t flag, uint8_t irqMask)
+	{
+		r.reg[B::STATUS::__address] |= flag;
+		if (!(r.reg[B::CONFIG::__address] & irqMask))
+			r.irq();
+	}
+
+	std::vector<Event> heap;
+	std::vector<std::vector<Transmission> > channels;
+	std::vector<std::vector<uint32_t> > tuned;
+};
+
+
+inline nRF24L01_SimRadio::nRF24L01_SimRadio(nRF24L01_SimAir &air)
+	: air(air), ceLevel(false), rpd(false), transmitting(false), pid(0)
+{
+	std::memset(reg, 0, sizeof(reg));
+	std::memset(lastPid, 0xFF, sizeof(lastPid));
+	std::memset(lastSrc, 0xFF, sizeof(lastSrc));
+	std::memset(ackPayload, 0, sizeof(ackPayload));
+	std::memset(&ackIn, 0, sizeof(ackIn));
+	for (uint8_t i = 0; i < REGISTER_COUNT; i++)
+		reg[REGISTERS[i].address] = REGISTERS[i].dflt;
+	id = air.attach(this, channel());
+}
+
+inline uint8_t nRF24L01_SimRadio::command(uint8_t cmd, const uint8_t *tx, uint8_t *rx, uint16_t n)
+{
+	uint8_t s = status();
+	if (n > PAYLOAD_MAX)
+		n = PAYLOAD_MAX;
+	if (cmd == CMD::W_TX_PAYLOAD || cmd == CMD::W_TX_PAYLOAD_NOACK)
+	{
+		if (!txFifo.full())
+		{
+			Packet &p = txFifo.push();
+			p.len = (uint8_t)n;
+			p.noack = cmd == CMD::W_TX_PAYLOAD_NOACK && (reg[FEATURE::__address] & FEATURE::EN_DYN_ACK::mask);
+			std::memcpy(p.data, tx, n);
+			/* CE already high in PTX: standby-II, sending starts right away */
+			if (ceLevel && poweredUp() && !(reg[CONFIG::__address] & CONFIG::PRIM_RX::mask) && !transmitting)
+				air.transmit(id);
+		}
+	}
+	else if ((cmd & ~0b111) == CMD::W_ACK_PAYLOAD && (cmd & 0b111) < 6)
+	{
+		Packet &p = ackPayload[cmd & 0b111];
+		p.len = (uint8_t)n;
+		std::memcpy(p.data, tx, n);
+	}
+	else if (cmd == CMD::R_RX_PAYLOAD)
+	{
+		if (!rxFifo.empty())
+		{
+			std::memcpy(rx, rxFifo.front().data, n);
+			rxFifo.pop();
+		}
+	}
+	else if (cmd == CMD::R_RX_PL_WID)
+	{
+		if (n)
+			rx[0] = rxFifo.empty() ? 0 : rxFifo.front().len;
+	}
+	else if (cmd == CMD::FLUSH_TX)
+	{
+		if (!transmitting)
+			txFifo.clear();
+	}
+	else if (cmd == CMD::FLUSH_RX)
+		rxFifo.clear();
+	else if ((cmd & 0b11100000) == CMD::W_REGISTER)
+	{
+		/* multi byte registers (addresses) are sent LSByte first */
+		if (n > 1)
+		{
+			uint64_t value = 0;
+			for (uint16_t i = 0; i < n && i < 8; i++)
+				value |= (uint64_t)tx[i] << (8 * i);
+			write(cmd & 0x1F, value, (uint16_t)(8 * (n < 8 ? n : 8)));
+		}
+		else
+			write(cmd & 0x1F, n ? tx[0] : (uint8_t)0);
+	}
+	else if ((cmd & 0b11100000) == CMD::R_REGISTER && n)
+	{
+		if (n > 1)
+		{
+			uint64_t value = read64(cmd & 0x1F);
+			for (uint16_t i = 0; i < n; i++)
+				rx[i] = i < 8 ? (uint8_t)(value >> (8 * i)) : 0;
+		}
+		else
+			rx[0] = read8(cmd & 0x1F);
+	}
+	return s;
+}
+
+inline void nRF24L01_SimRadio::ce(bool level)
+{
+	bool rising = level && !ceLevel;
+	if (!level && listening())
+		rpd = channelBusy();
+	ceLevel = level;
+	if (rising && poweredUp() && !(reg[CONFIG::__address] & CONFIG::PRIM_RX::mask) && !txFifo.empty() && !transmitting)
+		air.transmit(id);
+}
+
+inline bool nRF24L01_SimRadio::channelBusy() const
+{
+	return air.channelBusy(channel());
+}
+
+inline void nRF24L01_SimRadio::retune(uint8_t ch)
+{
+	if (ch != channel())
+		air.retune(id, channel(), ch);
+}
+
+inline uint8_t nRF24L01_SimRadio::crcBytes() const
+{
+	uint8_t config = (uint8_t)reg[CONFIG::__address];
+	if (!(config & CONFIG::EN_CRC::mask) && !(reg[EN_AA::__address] & 0b00111111))
+		return 0;
+	return config & CONFIG::CRCO::mask ? 2 : 1;
+}
+
+inline uint32_t nRF24L01_SimRadio::bitRate() const
+{
+	uint8_t setup = (uint8_t)reg[RF_SETUP::__address];
+	if (setup & RF_SETUP::RF_DR_LOW::mask)
+		return 250000;
+	return setup & RF_SETUP::RF_DR_HIGH::mask ? 2000000 : 1000000;
+}
+
+inline int nRF24L01_SimRadio::matchPipe(uint64_t address) const
+{
+	uint8_t aw = addressWidth();
+	uint64_t mask = (1ull << (8 * aw)) - 1;
+	uint8_t enabled = (uint8_t)reg[EN_RXADDR::__address];
+	address &= mask;
+	if ((enabled & 1) && (reg[RX_ADDR_P0::__address] & mask) == address)
+		return 0;
+	uint64_t base = reg[RX_ADDR_P1::__address] & mask & ~0xFFull;
+	if ((address & ~0xFFull) != base)
+		return -1;
+	if ((enabled & 2) && (reg[RX_ADDR_P1::__address] & 0xFF) == (address & 0xFF))
+		return 1;
+	for (int pipe = 2; pipe < 6; pipe++)
+		if ((enabled & (1u << pipe)) && reg[RX_ADDR_P2::__address + pipe - 2] == (address & 0xFF))
+			return pipe;
+	return -1;
+}
+
+#endif
@@ -0,0 +1,200 @@
+/*
+ * name:        nRF24L01+
+ * description: Single Chip 2.4GHz Transceiver
+ * manuf:       Nordic Semiconductor
+ * version:     0.1
+ * url:         https://www.nordicsemi.com/eng/content/download/2726/34069/file/nRF24L01P_Product_Specification_1_0.pdf
+ * date:        2017-12-19
+ * author       https://chisl.io/
+ * file:        nRF24L01_TimeSync.hpp
+ */
+
+#ifndef NRF24L01_TIMESYNC_HPP
+#define NRF24L01_TIMESYNC_HPP
+
+#include "nRF24L01_.hpp"
+#include "nRF24L01_Esb.hpp"
+
+/*
+ * Flooding Time Synchronization Protocol (FTSP) over no-ack broadcasts.
+ * The node with the lowest id is root; every synchronized node floods
+ * beacons carrying its estimate of global time at the CE pulse that starts
+ * the beacon. The receiver stamps the RX_DR IRQ edge, which comes a fixed
+ * TX settling time plus the airtime of the packet later; that airtime
+ * follows from RF_SETUP, SETUP_AW and the CRC length (CONFIG, forced on
+ * by EN_AA) and is added to the beacon time. Skew is estimated by linear
+ * regression over the last N (local, global - local) pairs.
+ *
+ * Times are us of a free running uint32_t local clock; wrap-around is
+ * handled as long as the N entries span less than 35 minutes.
+ */
+
+/* Beacon payload */
+struct nRF24L01_TimeSyncBeacon
+{
+	static const uint8_t MAGIC = 0xA2;
+	static const uint8_t SIZE = 8;  // MAGIC, root id (2), seq, global time (4), little endian
+};
+
+template<uint8_t N=8>
+class nRF24L01_TimeSync
+{
+public:
+	typedef nRF24L01_Base B;
+	typedef nRF24L01_TimeSyncBeacon Beacon;
+
+	static const uint8_t ENTRIES_TO_SYNC = 3;  // entries before global time is trusted
+	static const uint8_t ROOT_TIMEOUT = 5;  // beacon periods without root before claiming it
+	static const uint32_t SETTLE_US = 130;  // TX settling, see page 72
+
+	nRF24L01_TimeSync(nRF24L01_Base &radio, uint16_t id)
+		: radio(radio), id(id), root(id), loadUs(0), seq(0), heard(0), entries(0), next(0), skew(0.0), localRef(0), offsetRef(0)
+	{
+		configure();
+	}
+
+	/* Cache the airtime of a beacon, call again after changing data rate, address width or CRC */
+	void configure()
+	{
+		uint8_t setup = radio.getRF_SETUP();
+		uint32_t rate = setup & B::RF_SETUP::RF_DR_LOW::mask ? 250 : setup & B::RF_SETUP::RF_DR_HIGH::mask ? 2000 : 1000;  /* kbps */
+		uint8_t aw = (radio.getSETUP_AW() & B::SETUP_AW::AW::mask) + 2;
+		uint8_t config = radio.getCONFIG();
+		bool enCrc = (config & B::CONFIG::EN_CRC::mask) || (radio.getEN_AA() & ~B::EN_AA::__reserved);  /* EN_AA forces CRC on */
+		uint8_t crc = enCrc ? (config & B::CONFIG::CRCO::mask ? 2 : 1) : 0;
+		delayUs = SETTLE_US + nRF24L01_Esb::bits(aw, Beacon::SIZE, crc) * 1000u / rate;
+	}
+
+	/* Global time for a local timestamp */
+	uint32_t globalTime(uint32_t local) const
+	{
+		if (root == id)
+			return local;
+		int32_t dt = (int32_t)(local - localRef);
+		return local + (uint32_t)(offsetRef + (int32_t)(skew * dt));
+	}
+
+	bool synchronized() const
+	{
+		return root == id || entries >= ENTRIES_TO_SYNC;
+	}
+
+	/* Process a received payload stamped at its RX_DR IRQ edge, false if it is no beacon */
+	bool onBeacon(const uint8_t *payload, uint8_t n, uint32_t rxLocal)
+	{
+		if (n < Beacon::SIZE || payload[0] != Beacon::MAGIC)
+			return false;
+		uint16_t beaconRoot = payload[1] | payload[2] << 8;
+		uint8_t beaconSeq = payload[3];
+		uint32_t global = payload[4] | payload[5] << 8 | payload[6] << 16 | (uint32_t)payload[7] << 24;
+		if (beaconRoot > root || (beaconRoot == root && (int8_t)(beaconSeq - seq) <= 0 && entries))
+			return true;  /* worse root or already seen */
+		if (beaconRoot < root)
+		{
+			root = beaconRoot;
+			entries = next = 0;
+		}
+		seq = beaconSeq;
+		heard = 0;
+		add(rxLocal, global + delayUs);
+		return true;
+	}
+
+	/* Call once per beacon period; the root and synchronized nodes send a beacon */
+	void tick(uint32_t local)
+	{
+		if (root != id && ++heard > ROOT_TIMEOUT)
+		{
+			root = id;  /* root lost, claim it */
+			entries = next = 0;
+		}
+		if (root == id)
+			seq++;
+		if (synchronized())
+			sendBeacon(local);
+	}
+
+	/*
+	 * Send a beacon, local read right before the call. The payload is loaded
+	 * before the CE pulse, so the beacon is stamped loadUs after local.
+	 */
+	void sendBeacon(uint32_t local)
+	{
+		load(globalTime(local + loadUs));
+		radio.pulseCe();
+	}
+
+	/*
+	 * Send a beacon stamped for the instant loadUs after clock() is read:
+	 * the payload is loaded first and the CE pulse waits for that instant.
+	 * If loading took longer, loadUs grows to the measured time.
+	 */
+	void sendBeacon(uint32_t (*clock)(void *context), void *context)
+	{
+		uint32_t at = clock(context) + loadUs;
+		load(globalTime(at));
+		int32_t late = (int32_t)(clock(context) - at);
+		if (late > 0)
+			loadUs += late;
+		while ((int32_t)(clock(context) - at) < 0)
+			;
+		radio.pulseCe();
+	}
+
+	nRF24L01_Base &radio;
+	uint16_t id;
+	uint16_t root;
+	uint32_t delayUs;  // CE pulse to RX_DR
+	uint32_t loadUs;  // payload load before the CE pulse, see sendBeacon()
+
+private:
+	void load(uint32_t global)
+	{
+		uint8_t payload[Beacon::SIZE];
+		payload[0] = Beacon::MAGIC;
+		payload[1] = (uint8_t)root;
+		payload[2] = (uint8_t)(root >> 8);
+		payload[3] = seq;
+		for (uint8_t i = 0; i < 4; i++)
+			payload[4 + i] = (uint8_t)(global >> (8 * i));
+		radio.writeTxPayloadNoAck(payload, Beacon::SIZE);
+	}
+
+	/* Add a (local, global) pair and redo the regression */
+	void add(uint32_t local, uint32_t global)
+	{
+		localAt[next] = local;
+		offsetAt[next] = (int32_t)(global - local);
+		next = (next + 1) % N;
+		if (entries < N)
+			entries++;
+
+		/* regression of offset over local, relative to the newest entry to keep values small */
+		double sumX = 0, sumY = 0, sumXX = 0, sumXY = 0;
+		for (uint8_t i = 0; i < entries; i++)
+		{
+			double x = (int32_t)(localAt[i] - local);
+			double y = offsetAt[i] - offsetAt[(next + N - 1) % N];
+			sumX += x;
+			sumY += y;
+			sumXX += x * x;
+			sumXY += x * y;
+		}
+		double meanX = sumX / entries, meanY = sumY / entries;
+		double varX = sumXX - sumX * meanX;
+		skew = entries > 1 && varX > 0 ? (sumXY - sumX * meanY) / varX : 0.0;
+		localRef = local + (int32_t)meanX;
+		offsetRef = offsetAt[(next + N - 1) % N] + (int32_t)meanY;
+	}
+
+	uint8_t seq;
+	uint8_t heard;  // beacon periods since the root was last heard
+	uint8_t entries, next;
+	uint32_t localAt[N];
+	int32_t offsetAt[N];
+	double skew;  // d(offset)/d(local)
+	uint32_t localRef;  // regression point
+	int32_t offsetRef;
+};
+
+#endif
@@ -0,0 +1,379 @@
+/*
+ * name:        nRF24L01+
+ * description: Single Chip 2.4GHz Transceiver
+ * manuf:       Nordic Semiconductor
+ * version:     0.1
+ * url:         https://www.nordicsemi.com/eng/content/download/2726/34069/file/nRF24L01P_Product_Specification_1_0.pdf
+ * date:        2017-12-19
+ * author       https://chisl.io/
+ * file:        nRF24L01_Trace.hpp
+ */
+
+#ifndef NRF24L01_TRACE_HPP
+#define NRF24L01_TRACE_HPP
+
+#include "nRF24L01_.hpp"
+#include "nRF24L01_Sim.hpp"
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * SPI transaction trace. nRF24L01_TraceRecorder wraps any nRF24L01_Base and
+ * logs every transport call into a caller provided ring of fixed 16 byte
+ * records; dump() writes the ring to a memory mapped file. nRF24L01_TraceReplay
+ * maps such a file and re-issues it against another nRF24L01_Base, typically
+ * a nRF24L01_SimRadio.
+ */
+
+/* One trace record */
+struct nRF24L01_TraceRecord
+{
+	/* Record types */
+	struct OP
+	{
+		static const uint8_t READ8 = 0;
+		static const uint8_t WRITE8 = 1;
+		static const uint8_t READ64 = 2;
+		static const uint8_t WRITE64 = 3;
+		static const uint8_t COMMAND = 4;  // value: STATUS
+		static const uint8_t DATA = 5;  // up to 8 payload bytes of the preceding COMMAND or DYNAMIC
+		static const uint8_t CE = 6;  // value: level
+		static const uint8_t DYNAMIC = 7;  // readDynamicPayload(), value: width
+	};
+
+	uint64_t value;
+	uint32_t time;  // us, wraps after 71 minutes
+	uint8_t op;
+	uint8_t address;  // register address or SPI command
+	uint16_t n;  // bits for registers, bytes for commands
+};
+
+/* File header of a dumped trace */
+struct nRF24L01_TraceFile
+{
+	static const uint32_t MAGIC = 0x5446524E;  // "NRFT"
+	static const uint32_t VERSION = 1;
+
+	uint32_t magic;
+	uint32_t version;
+	uint64_t count;
+};
+
+
+/* Recording decorator transport */
+class nRF24L01_TraceRecorder : public nRF24L01_Base
+{
+public:
+	typedef nRF24L01_TraceRecord Record;
+
+	/* capacity must be a power of two */
+	nRF24L01_TraceRecorder(nRF24L01_Base &inner, Record *ring, uint32_t capacity)
+		: inner(inner), ring(ring), mask(capacity - 1), head(0) {}
+
+	/* Timestamp source, override for a cycle counter or a simulated clock */
+	virtual uint32_t micros()
+	{
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return (uint32_t)(ts.tv_sec * 1000000ull + ts.tv_nsec / 1000);
+	}
+
+	uint8_t read8(uint16_t address, uint16_t n=8)
+	{
+		uint8_t value = inner.read8(address, n);
+		log(Record::OP::READ8, address, n, value);
+		return value;
+	}
+
+	void write(uint16_t address, uint8_t value, uint16_t n=8)
+	{
+		inner.write(address, value, n);
+		log(Record::OP::WRITE8, address, n, value);
+	}
+
+	uint64_t read64(uint16_t address, uint16_t n=64)
+	{
+		uint64_t value = inner.read64(address, n);
+		log(Record::OP::READ64, address, n, value);
+		return value;
+	}
+
+	void write(uint16_t address, uint64_t value, uint16_t n=64)
+	{
+		inner.write(address, value, n);
+		log(Record::OP::WRITE64, address, n, value);
+	}
+
+	uint8_t command(uint8_t cmd, const uint8_t *tx, uint8_t *rx, uint16_t n)
+	{
+		uint8_t status = inner.command(cmd, tx, rx, n);
+		log(Record::OP::COMMAND, cmd, n, status);
+		logData(cmd, rx ? rx : tx, n);
+		return status;
+	}
+
+	/* Forwarded so an inner single transaction read is kept */
+	uint8_t readDynamicPayload(uint8_t *buffer)
+	{
+		uint8_t n = inner.readDynamicPayload(buffer);
+		log(Record::OP::DYNAMIC, CMD::R_RX_PAYLOAD, n, n);
+		logData(CMD::R_RX_PAYLOAD, buffer, n);
+		return n;
+	}
+
+	void ce(bool level)
+	{
+		inner.ce(level);
+		log(Record::OP::CE, 0, 1, level);
+	}
+
+	void delayUs(uint32_t us)
+	{
+		inner.delayUs(us);
+	}
+
+	/* Records held, at most capacity */
+	uint32_t size() const
+	{
+		return head > mask ? mask + 1 : (uint32_t)head;
+	}
+
+	/*
+	 * Write the ring, oldest record first, to a memory mapped file. Once the
+	 * ring has wrapped the oldest records may be DATA of an overwritten
+	 * command; those are left out. Returns false on error.
+	 */
+	bool dump(const char *path)
+	{
+		uint32_t count = size();
+		uint64_t first = head - count;
+		while (count && ring[first & mask].op == Record::OP::DATA)
+		{
+			first++;
+			count--;
+		}
+		size_t bytes = sizeof(nRF24L01_TraceFile) + count * sizeof(Record);
+		int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+		if (fd < 0)
+			return false;
+		if (ftruncate(fd, bytes) != 0)
+		{
+			close(fd);
+			return false;
+		}
+		void *map = mmap(0, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		close(fd);
+		if (map == MAP_FAILED)
+			return false;
+		nRF24L01_TraceFile *file = (nRF24L01_TraceFile *)map;
+		file->magic = nRF24L01_TraceFile::MAGIC;
+		file->version = nRF24L01_TraceFile::VERSION;
+		file->count = count;
+		Record *out = (Record *)(file + 1);
+		for (uint32_t i = 0; i < count; i++)
+			out[i] = ring[(first + i) & mask];
+		munmap(map, bytes);
+		return true;
+	}
+
+	nRF24L01_Base &inner;
+
+private:
+	void log(uint8_t op, uint16_t address, uint16_t n, uint64_t value)
+	{
+		Record &r = ring[head++ & mask];
+		r.value = value;
+		r.time = micros();
+		r.op = op;
+		r.address = (uint8_t)address;
+		r.n = n;
+	}
+
+	void logData(uint8_t cmd, const uint8_t *data, uint16_t n)
+	{
+		for (uint16_t i = 0; data && i < n; i += 8)
+		{
+			uint64_t chunk = 0;
+			std::memcpy(&chunk, data + i, n - i < 8 ? n - i : 8);
+			log(Record::OP::DATA, cmd, n - i < 8 ? n - i : 8, chunk);
+		}
+	}
+
+	Record *ring;
+	uint32_t mask;
+	uint64_t head;
+};
+
+
+/* Re-issues a dumped trace against a target */
+class nRF24L01_TraceReplay
+{
+public:
+	typedef nRF24L01_TraceRecord Record;
+
+	nRF24L01_TraceReplay() : records(0), count(0), mismatches(0), map(0), bytes(0) {}
+	~nRF24L01_TraceReplay() { close(); }
+
+	/* Map a trace file, returns false if it is not one or holds malformed records */
+	bool open(const char *path)
+	{
+		close();
+		int fd = ::open(path, O_RDONLY);
+		if (fd < 0)
+			return false;
+		struct stat st;
+		if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(nRF24L01_TraceFile))
+		{
+			::close(fd);
+			return false;
+		}
+		bytes = st.st_size;
+		map = mmap(0, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+		::close(fd);
+		if (map == MAP_FAILED)
+		{
+			map = 0;
+			return false;
+		}
+		const nRF24L01_TraceFile *file = (const nRF24L01_TraceFile *)map;
+		if (file->magic != nRF24L01_TraceFile::MAGIC || file->version != nRF24L01_TraceFile::VERSION
+			|| sizeof(*file) + file->count * sizeof(Record) > bytes)
+		{
+			close();
+			return false;
+		}
+		records = (const Record *)(file + 1);
+		count = file->count;
+		if (!valid())
+		{
+			close();
+			return false;
+		}
+		return true;
+	}
+
+	void close()
+	{
+		if (map)
+			munmap(map, bytes);
+		map = 0;
+		records = 0;
+		count = 0;
+	}
+
+	/*
+	 * Re-issue all records against target. If air is given, simulated time is
+	 * advanced to the recorded timestamps first, so the simulator sees the
+	 * same spacing as production. Reads are compared with the recorded values,
+	 * differences are counted in mismatches.
+	 */
+	void run(nRF24L01_Base &target, nRF24L01_SimAir *air=0)
+	{
+		uint8_t buffer[nRF24L01_Base::PAYLOAD_MAX];
+		uint64_t start = air ? air->now : 0;
+		mismatches = 0;
+		for (uint64_t i = 0; i < count; i++)
+		{
+			const Record &r = records[i];
+			if (air)
+				air->run(start + (uint32_t)(r.time - records[0].time));
+			switch (r.op)
+			{
+			case Record::OP::READ8: check(target.read8(r.address, r.n), r.value); break;
+			case Record::OP::WRITE8: target.write(r.address, (uint8_t)r.value, r.n); break;
+			case Record::OP::READ64: check(target.read64(r.address, r.n), r.value); break;
+			case Record::OP::WRITE64: target.write(r.address, (uint64_t)r.value, r.n); break;
+			case Record::OP::CE: target.ce(r.value != 0); break;
+			case Record::OP::COMMAND:
+			case Record::OP::DYNAMIC:
+				i = replayCommand(target, i, buffer);
+				break;
+			}
+		}
+	}
+
+	const Record *records;
+	uint64_t count;
+	uint64_t mismatches;
+
+private:
+	/*
+	 * The file is untrusted: commands carry at most PAYLOAD_MAX bytes, DATA
+	 * records 1 to 8 bytes, and only directly after the command they belong
+	 * to and not beyond its length. A command with payload must be followed
+	 * by DATA covering all of it, so replay never sends unset bytes. DATA
+	 * records at the start belong to a command lost when the ring wrapped;
+	 * they are skipped, run() ignores them.
+	 */
+	bool valid() const
+	{
+		uint64_t i = 0;
+		while (i < count && records[i].op == Record::OP::DATA)
+			i++;
+		uint16_t left = 0;
+		for (; i < count; i++)
+		{
+			const Record &r = records[i];
+			if (r.op != Record::OP::DATA && left)
+				return false;
+			if (r.op == Record::OP::COMMAND || r.op == Record::OP::DYNAMIC)
+			{
+				if (r.n > nRF24L01_Base::PAYLOAD_MAX)
+					return false;
+				left = r.n;
+			}
+			else if (r.op == Record::OP::DATA)
+			{
+				if (r.n == 0 || r.n > 8 || r.n > left)
+					return false;
+				left -= r.n;
+			}
+			else if (r.op > Record::OP::DYNAMIC)
+				return false;
+		}
+		return left == 0;
+	}
+
+	/* Returns index of the last DATA record belonging to the command at i */
+	uint64_t replayCommand(nRF24L01_Base &target, uint64_t i, uint8_t *buffer)
+	{
+		const Record &c = records[i];
+		uint16_t n = c.n;
+		uint16_t got = 0;
+		while (i + 1 < count && records[i + 1].op == Record::OP::DATA)
+		{
+			const Record &d = records[++i];
+			std::memcpy(buffer + got, &d.value, d.n);
+			got += d.n;
+		}
+		uint8_t rx[nRF24L01_Base::PAYLOAD_MAX];
+		if (c.op == Record::OP::DYNAMIC)
+		{
+			check(target.readDynamicPayload(rx), c.value);
+			if (std::memcmp(rx, buffer, got) != 0)
+				mismatches++;
+			return i;
+		}
+		bool isRead = c.address == nRF24L01_Base::CMD::R_RX_PAYLOAD || c.address == nRF24L01_Base::CMD::R_RX_PL_WID
+			|| (c.address & 0b11100000) == nRF24L01_Base::CMD::R_REGISTER;
+		check(target.command(c.address, isRead ? 0 : buffer, isRead ? rx : 0, n), c.value);
+		if (isRead && std::memcmp(rx, buffer, got) != 0)
+			mismatches++;
+		return i;
+	}
+
+	void check(uint64_t got, uint64_t expected)
+	{
+		if (got != expected)
+			mismatches++;
+	}
+
+	void *map;
+	size_t bytes;
+};
+
+#endif
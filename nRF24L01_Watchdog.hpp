@@ -0,0 +1,250 @@
+/*
+ * name:        nRF24L01+
+ * description: Single Chip 2.4GHz Transceiver
+ * manuf:       Nordic Semiconductor
+ * version:     0.1
+ * url:         https://www.nordicsemi.com/eng/content/download/2726/34069/file/nRF24L01P_Product_Specification_1_0.pdf
+ * date:        2017-12-19
+ * author       https://chisl.io/
+ * file:        nRF24L01_Watchdog.hpp
+ */
+
+#ifndef NRF24L01_WATCHDOG_HPP
+#define NRF24L01_WATCHDOG_HPP
+
+#include "nRF24L01_.hpp"
+
+/*
+ * Health monitor with minimal recovery. check() reads the registers in
+ * monitor and compares them with a shadow taken by expect() after
+ * initialization; bits in ignore[] (by default CONFIG::PRIM_RX) follow the
+ * chip, for state the application changes at run time such as RF_CH when
+ * hopping. The chip has no multi-register burst read, every register
+ * costs one SPI transaction, so by default only the one byte control and
+ * status registers are read (MONITOR_DEFAULT, 13 transactions). A power on
+ * reset or brown-out clears CONFIG::PWR_UP, which is among them; add the
+ * address and RX_PW_Px registers to monitor to check those too.
+ *
+ * Recovery escalates:
+ * - a TX FIFO that stays non-empty without progress (FIFO_STATUS and
+ *   OBSERVE_TX unchanged), or MAX_RT left set, for STALL_CHECKS checks:
+ *   FLUSH_TX and clear MAX_RT
+ * - RX_FULL without progress (RX_DR and RX_P_NO unchanged and no
+ *   received() call in between) for STALL_CHECKS checks: FLUSH_RX and
+ *   clear RX_DR. Report reads with received(), or put handler() in front
+ *   of the receive handler, so a full FIFO that is being drained is not
+ *   flushed
+ * - registers differing from the shadow (CONFIG, a forced PLL_LOCK, ...):
+ *   write only those registers again
+ * - a rewrite that does not read back, or recovery needed in ESCALATE
+ *   consecutive checks: soft reset, i.e. power down through CONFIG::PWR_UP,
+ *   write all registers, flush both FIFOs and power up again
+ * - another escalation before a healthy check, if a power switch was given
+ *   with powerControl(): cut the supply, wait for the power on reset and
+ *   write all registers
+ *
+ * Both resets leave CE low; the caller restores its RX/TX activity.
+ */
+
+/* Switches the supply of the radio, e.g. a GPIO driven load switch */
+typedef void (*nRF24L01_PowerSwitch)(void *context, bool on);
+
+class nRF24L01_Watchdog
+{
+public:
+	typedef nRF24L01_Base B;
+	static const uint8_t N = B::REGISTER_COUNT;
+
+	/* Recovery actions, returned by check() */
+	struct ACTION
+	{
+		static const uint8_t FLUSH_TX = 0x01;
+		static const uint8_t FLUSH_RX = 0x02;
+		static const uint8_t REWRITE = 0x04;
+		static const uint8_t SOFT_RESET = 0x08;
+		static const uint8_t POWER_CYCLE = 0x10;
+	};
+
+	static const uint8_t STALL_CHECKS = 3;
+	static const uint8_t ESCALATE = 3;
+	static const uint32_t POWER_OFF_US = 10000;  // supply off, lets the decoupling discharge
+	static const uint32_t POWER_ON_US = 100000;  // power on reset, see 6.1.1
+
+	/* CONFIG to RF_SETUP, STATUS, OBSERVE_TX, RPD, FIFO_STATUS, DYNPD and FEATURE */
+	static const uint32_t MONITOR_DEFAULT = 0x038003FF;
+
+	nRF24L01_Watchdog(nRF24L01_Base &radio)
+		: radio(radio), monitor(MONITOR_DEFAULT), flushesTx(0), flushesRx(0), rewrites(0), softResets(0), powerCycles(0),
+		  power(0), powerContext(0), deliver(0), context(0), reads(0), lastReads(0),
+		  txStall(0), rxStall(0), failing(0), resets(0), lastFifo(0), lastObserve(0), lastRx(0)
+	{
+		for (uint8_t i = 0; i < N; i++)
+			shadow[i] = ignore[i] = 0;
+		ignore[B::registerIndex(B::CONFIG::__address)] = B::CONFIG::PRIM_RX::mask;
+	}
+
+	/* Take the current registers as the expected configuration */
+	void expect()
+	{
+		radio.readRegisters(shadow);
+	}
+
+	/* Take values (e.g. from nRF24L01_Base::decodeSnapshot()) as the expected configuration */
+	void expect(const uint64_t values[N])
+	{
+		for (uint8_t i = 0; i < N; i++)
+			shadow[i] = values[i];
+	}
+
+	/* Let recovery cut the supply when a soft reset did not help */
+	void powerControl(nRF24L01_PowerSwitch power, void *context=0)
+	{
+		this->power = power;
+		powerContext = context;
+	}
+
+	/* Count a payload read by the application, marks progress of the RX FIFO */
+	void received()
+	{
+		reads++;
+	}
+
+	/* Forward payloads to deliver, for use in front of another handler */
+	void chain(nRF24L01_ReceiveHandler deliver, void *context=0)
+	{
+		this->deliver = deliver;
+		this->context = context;
+	}
+
+	/* nRF24L01_ReceiveHandler for nRF24L01_Base::service(), context is the watchdog */
+	static void handler(void *context, uint8_t pipe, const uint8_t *data, uint8_t n)
+	{
+		nRF24L01_Watchdog *w = static_cast<nRF24L01_Watchdog *>(context);
+		w->received();
+		if (w->deliver)
+			w->deliver(w->context, pipe, data, n);
+	}
+
+	/* Call periodically, returns the ACTION flags taken */
+	uint8_t check()
+	{
+		uint64_t actual[N], wanted[N];
+		read(actual);
+		uint8_t status = (uint8_t)actual[B::registerIndex(B::STATUS::__address)];
+		uint8_t fifo = (uint8_t)actual[B::registerIndex(B::FIFO_STATUS::__address)];
+		uint8_t observe = (uint8_t)actual[B::registerIndex(B::OBSERVE_TX::__address)];
+
+		bool txIdle = (fifo & B::FIFO_STATUS::TX_EMPTY::mask) && !(status & B::STATUS::MAX_RT::mask);
+		txStall = txIdle || fifo != lastFifo || observe != lastObserve ? 0 : txStall + 1;
+		if ((status & B::STATUS::MAX_RT::mask) && txStall == 0)
+			txStall = 1;  /* MAX_RT blocks the TX FIFO until cleared */
+		uint8_t rx = status & (B::STATUS::RX_DR::mask | B::STATUS::RX_P_NO::mask);
+		bool rxProgress = reads != lastReads || rx != lastRx;
+		rxStall = (fifo & B::FIFO_STATUS::RX_FULL::mask) && !rxProgress ? rxStall + 1 : 0;
+		lastFifo = fifo;
+		lastObserve = observe;
+		lastRx = rx;
+		lastReads = reads;
+
+		uint8_t actions = 0;
+		uint32_t diff = divergent(actual, wanted);
+		if (diff)
+		{
+			radio.writeRegisters(wanted, diff);
+			rewrites++;
+			actions |= ACTION::REWRITE;
+			read(actual);
+			if (divergent(actual, wanted))
+				return actions | reset(actual);
+		}
+		if (txStall >= STALL_CHECKS)
+		{
+			radio.flushTx();
+			radio.setSTATUS(B::STATUS::MAX_RT::mask);
+			flushesTx++;
+			txStall = 0;
+			actions |= ACTION::FLUSH_TX;
+		}
+		if (rxStall >= STALL_CHECKS)
+		{
+			radio.flushRx();
+			radio.setSTATUS(B::STATUS::RX_DR::mask);
+			flushesRx++;
+			rxStall = 0;
+			actions |= ACTION::FLUSH_RX;
+		}
+		failing = actions ? failing + 1 : 0;
+		if (!actions)
+			resets = 0;
+		if (failing >= ESCALATE)
+			actions |= reset(actual);
+		return actions;
+	}
+
+	nRF24L01_Base &radio;
+	uint32_t monitor;  // bit i: REGISTERS[i] is read and compared by check()
+	uint64_t ignore[N];  // bits of REGISTERS[i] not compared
+	uint32_t flushesTx, flushesRx, rewrites, softResets, powerCycles;
+
+private:
+	/* Read the monitored registers, the others are taken from the shadow */
+	void read(uint64_t actual[N])
+	{
+		for (uint8_t i = 0; i < N; i++)
+			actual[i] = shadow[i];
+		radio.readRegisters(actual, monitor);
+	}
+
+	/* Fill wanted from the shadow and return the mask of registers that differ from actual */
+	uint32_t divergent(const uint64_t actual[N], uint64_t wanted[N]) const
+	{
+		for (uint8_t i = 0; i < N; i++)
+			wanted[i] = (shadow[i] & ~ignore[i]) | (actual[i] & ignore[i]);
+		return B::diffRegisters(wanted, actual);
+	}
+
+	/* Soft reset, or a power cycle if the last reset did not help and a power switch is set */
+	uint8_t reset(const uint64_t actual[N])
+	{
+		uint64_t wanted[N];
+		divergent(actual, wanted);
+		uint8_t c = B::registerIndex(B::CONFIG::__address);
+		uint8_t action = ACTION::SOFT_RESET;
+		radio.ce(false);
+		if (power && resets)
+		{
+			power(powerContext, false);
+			radio.delayUs(POWER_OFF_US);
+			power(powerContext, true);
+			radio.delayUs(POWER_ON_US);
+			powerCycles++;
+			action = ACTION::POWER_CYCLE;
+		}
+		else
+			softResets++;
+		radio.setCONFIG((uint8_t)wanted[c] & ~B::CONFIG::PWR_UP::mask);
+		radio.writeRegisters(wanted, ~(1u << c));
+		radio.flushTx();
+		radio.flushRx();
+		radio.setSTATUS(B::STATUS::__clear);
+		radio.writeRegisters(wanted, 1u << c);
+		if (wanted[c] & B::CONFIG::PWR_UP::mask)
+			radio.delayUs(B::SNAPSHOT::POWER_UP_US);
+		resets++;
+		failing = txStall = rxStall = 0;
+		return action;
+	}
+
+	nRF24L01_PowerSwitch power;
+	void *powerContext;
+	nRF24L01_ReceiveHandler deliver;
+	void *context;
+	uint32_t reads, lastReads;  // received() calls
+	uint64_t shadow[N];
+	uint8_t txStall, rxStall;  // consecutive checks with the FIFO stuck
+	uint8_t failing;  // consecutive checks that needed recovery
+	uint8_t resets;  // resets since the last check without recovery
+	uint8_t lastFifo, lastObserve, lastRx;
+};
+
+#endif
@@ -0,0 +1,133 @@
+/*
+ * name:        nRF24L01+
+ * description: Single Chip 2.4GHz Transceiver
+ * manuf:       Nordic Semiconductor
+ * version:     0.1
+ * url:         https://www.nordicsemi.com/eng/content/download/2726/34069/file/nRF24L01P_Product_Specification_1_0.pdf
+ * date:        2017-12-19
+ * author       https://chisl.io/
+ * file:        arq_check.cpp
+ */
+
+/*
+ * Selective repeat ARQ over the simulator: 1000 frames of 30 bytes with
+ * every fifth frame dropped at the receiver (20 % loss) must all arrive,
+ * in order, with about one retransmission per loss. ACK frames go back
+ * over the air with the radios turned around.
+ *
+ *   g++ -std=c++11 -I.. arq_check.cpp ../nRF24L01_.cpp -o arq_check && ./arq_check
+ *
+ * Exits with 1 if a check fails.
+ */
+
+#include "nRF24L01_Sim.hpp"
+#include "nRF24L01_Arq.hpp"
+#include <cstdio>
+
+static int failures = 0;
+
+static void expect(bool ok, const char *what)
+{
+	std::printf("%s: %s\n", ok ? "ok  " : "FAIL", what);
+	if (!ok)
+		failures++;
+}
+
+typedef nRF24L01_Base B;
+
+static const unsigned FRAMES = 1000;
+static const unsigned DROP_EVERY = 5;
+
+static const uint8_t PTX = B::CONFIG::EN_CRC::mask | B::CONFIG::CRCO::mask | B::CONFIG::PWR_UP::mask;
+static const uint8_t PRX = PTX | B::CONFIG::PRIM_RX::mask;
+
+static unsigned delivered = 0, received = 0, acks = 0;
+static bool inOrder = true, needAck = false;
+static nRF24L01_ArqReceiver<16> *receiver;
+
+static void deliver(void *, uint8_t, const uint8_t *data, uint8_t)
+{
+	if (data[0] != (uint8_t)delivered)
+		inOrder = false;
+	delivered++;
+}
+
+static void lossy(void *, uint8_t pipe, const uint8_t *data, uint8_t n)
+{
+	if (++received % DROP_EVERY == 0)
+		return;
+	needAck |= receiver->onData(pipe, data, n);
+}
+
+/*
+ * Send an ACK frame from b to a over the air: a stops sending once its TX
+ * FIFO is empty and listens, b sends as PTX, then both turn back.
+ */
+static void reverse(nRF24L01_SimAir &air, nRF24L01_SimRadio &a, nRF24L01_SimRadio &b, const uint8_t *ack,
+	nRF24L01_ArqSender<16> &sender)
+{
+	uint8_t width[6] = { 0, 0, 0, 0, 0, 0 };
+	while (!(a.getFIFO_STATUS() & B::FIFO_STATUS::TX_EMPTY::mask) || a.transmitting)
+		air.run(air.now + 100);
+	a.ce(false);
+	a.setCONFIG(PRX);
+	a.ce(true);
+	b.ce(false);
+	b.setCONFIG(PTX);
+	b.writeTxPayloadNoAck(ack, nRF24L01_ArqFrame::ACK_SIZE);
+	b.pulseCe();
+	air.run(air.now + 500);
+	b.setSTATUS(B::STATUS::TX_DS::mask);  /* RX_DR is left for b.service() */
+	a.service(nRF24L01_ArqSender<16>::handler, &sender, width);
+	a.ce(false);
+	a.setCONFIG(PTX);
+	b.setCONFIG(PRX);
+	b.ce(true);
+	acks++;
+}
+
+int main()
+{
+	nRF24L01_SimAir air;
+	nRF24L01_SimRadio a(air), b(air);
+	a.setCONFIG(PTX);
+	b.setCONFIG(PRX);
+	a.enableBroadcast(0xE7E7E7E7E7ull);
+	b.enableBroadcast(0xE7E7E7E7E7ull);
+	a.enableDynamicPayloads(1);
+	b.enableDynamicPayloads(1);
+	b.ce(true);
+
+	nRF24L01_ArqSender<16> sender(a, 3000);
+	nRF24L01_ArqReceiver<16> r(deliver);
+	receiver = &r;
+	uint8_t width[6] = { 0, 0, 0, 0, 0, 0 };
+	unsigned queued = 0;
+	for (unsigned t = 0; t < 20000 && delivered < FRAMES; t++)
+	{
+		while (queued < FRAMES)
+		{
+			uint8_t frame[nRF24L01_ArqFrame::PAYLOAD_MAX] = { (uint8_t)queued };
+			if (!sender.send(frame, sizeof(frame)))
+				break;
+			queued++;
+		}
+		sender.transmit((uint32_t)air.now);
+		air.run(air.now + 100);
+		a.service(0, 0, width);
+		b.service(lossy, 0, width);
+		if (needAck && t % 10 == 0)  /* reverse link every ms */
+		{
+			uint8_t ack[nRF24L01_ArqFrame::ACK_SIZE];
+			r.buildAck(ack);
+			reverse(air, a, b, ack, sender);
+			needAck = false;
+		}
+	}
+	std::printf("delivered %u, retransmissions %u, ACK frames %u, %llu us\n", delivered, sender.retransmissions, acks,
+		(unsigned long long)air.now);
+	expect(delivered == FRAMES, "all frames delivered");
+	expect(inOrder, "frames delivered in order");
+	expect(sender.retransmissions >= FRAMES / DROP_EVERY && sender.retransmissions < FRAMES / 2, "retransmissions close to the losses");
+	return failures ? 1 : 0;
+}
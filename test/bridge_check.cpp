@@ -0,0 +1,151 @@
+/*
+ * name:        nRF24L01+
+ * description: Single Chip 2.4GHz Transceiver
+ * manuf:       Nordic Semiconductor
+ * version:     0.1
+ * url:         https://www.nordicsemi.com/eng/content/download/2726/34069/file/nRF24L01P_Product_Specification_1_0.pdf
+ * date:        2017-12-19
+ * author       https://chisl.io/
+ * file:        bridge_check.cpp
+ */
+
+/*
+ * Bridge loopback: payloads sent over the simulator are polled from the
+ * receiving radio into the bridge and read back from the other end of a
+ * Unix socket pair, once as datagrams with static payloads and once as a
+ * stream with dynamic payloads.
+ *
+ *   g++ -std=c++11 -I.. bridge_check.cpp ../nRF24L01_.cpp -o bridge_check && ./bridge_check
+ *
+ * Exits with 1 if a check fails.
+ */
+
+#include "nRF24L01_Sim.hpp"
+#include "nRF24L01_Bridge.hpp"
+#include <cstdio>
+#include <unistd.h>
+
+static int failures = 0;
+
+static void expect(bool ok, const char *what)
+{
+	std::printf("%s: %s\n", ok ? "ok  " : "FAIL", what);
+	if (!ok)
+		failures++;
+}
+
+typedef nRF24L01_Base B;
+typedef nRF24L01_BridgeRecord R;
+
+static const uint8_t PTX = B::CONFIG::EN_CRC::mask | B::CONFIG::CRCO::mask | B::CONFIG::PWR_UP::mask;
+static const uint8_t PRX = PTX | B::CONFIG::PRIM_RX::mask;
+static const uint8_t RADIO_ID = 7;
+static const unsigned PACKETS = 10;
+
+/* Send PACKETS payloads of length(i) bytes, each i + k, polling rx into bridge after each */
+template<unsigned N>
+static void send(nRF24L01_SimAir &air, nRF24L01_SimRadio &tx, nRF24L01_SimRadio &rx,
+	nRF24L01_Bridge<N> &bridge, const uint8_t width[6], uint8_t (*length)(unsigned))
+{
+	uint8_t data[B::PAYLOAD_MAX];
+	for (unsigned i = 0; i < PACKETS; i++)
+	{
+		for (uint8_t k = 0; k < length(i); k++)
+			data[k] = (uint8_t)(i + k);
+		tx.writeTxPayload(data, length(i));
+		tx.pulseCe();
+		air.run(air.now + 2000);
+		tx.setSTATUS(B::STATUS::__clear);
+		bridge.poll(rx, RADIO_ID, width);
+	}
+}
+
+/* True if record r holds packet i */
+static bool matches(const R &r, unsigned i, uint8_t n)
+{
+	if (r.radio != RADIO_ID || r.pipe != 0 || r.length != n)
+		return false;
+	for (uint8_t k = 0; k < n; k++)
+		if (r.payload[k] != (uint8_t)(i + k))
+			return false;
+	return true;
+}
+
+static uint8_t fixed(unsigned)
+{
+	return 8;
+}
+
+static uint8_t growing(unsigned i)
+{
+	return (uint8_t)(1 + i * 3 % B::PAYLOAD_MAX);
+}
+
+static void datagram()
+{
+	int fds[2];
+	socketpair(AF_UNIX, SOCK_DGRAM, 0, fds);
+	nRF24L01_SimAir air;
+	nRF24L01_SimRadio tx(air), rx(air);
+	tx.setCONFIG(PTX);
+	rx.setCONFIG(PRX);
+	rx.setRX_PW_P0(8);
+	rx.ce(true);
+	uint8_t width[6] = { 8, 0, 0, 0, 0, 0 };
+	nRF24L01_Bridge<4> bridge(fds[0]);  /* smaller than PACKETS, so poll() flushes on the way */
+	send(air, tx, rx, bridge, width, fixed);
+	bridge.flush();
+	expect(bridge.sent == PACKETS && bridge.dropped == 0, "datagram bridge sends every payload");
+	bool ok = true;
+	for (unsigned i = 0; i < PACKETS; i++)
+	{
+		R r;
+		ssize_t n = recv(fds[1], &r, sizeof(r), MSG_DONTWAIT);
+		ok &= n == R::HEADER + 8 && matches(r, i, 8);
+	}
+	expect(ok, "one datagram per payload, header and payload intact");
+	close(fds[0]);
+	close(fds[1]);
+}
+
+static void stream()
+{
+	int fds[2];
+	socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+	nRF24L01_SimAir air;
+	nRF24L01_SimRadio tx(air), rx(air);
+	tx.setCONFIG(PTX);
+	rx.setCONFIG(PRX);
+	tx.enableDynamicPayloads(1);
+	rx.enableDynamicPayloads(1);
+	rx.ce(true);
+	uint8_t width[6] = { 0, 0, 0, 0, 0, 0 };
+	nRF24L01_Bridge<16> bridge(fds[0], true);
+	send(air, tx, rx, bridge, width, growing);
+	bridge.flush();
+	expect(bridge.sent == PACKETS && bridge.pending() == 0, "stream bridge sends every payload");
+	uint8_t bytes[PACKETS * sizeof(R)];
+	ssize_t n = recv(fds[1], bytes, sizeof(bytes), MSG_DONTWAIT);
+	bool ok = n > 0;
+	size_t at = 0;
+	for (unsigned i = 0; ok && i < PACKETS; i++)
+	{
+		R r;
+		std::memcpy(&r, bytes + at, R::HEADER);
+		ok = at + R::HEADER + r.length <= (size_t)n;
+		if (ok)
+			std::memcpy(r.payload, bytes + at + R::HEADER, r.length);
+		ok = ok && matches(r, i, growing(i));
+		at += R::HEADER + r.length;
+	}
+	expect(ok && at == (size_t)n, "stream records framed by their header, dynamic lengths intact");
+	close(fds[0]);
+	close(fds[1]);
+}
+
+int main()
+{
+	datagram();
+	stream();
+	return failures ? 1 : 0;
+}
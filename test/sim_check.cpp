@@ -0,0 +1,159 @@
+/*
+ * name:        nRF24L01+
+ * description: Single Chip 2.4GHz Transceiver
+ * manuf:       Nordic Semiconductor
+ * version:     0.1
+ * url:         https://www.nordicsemi.com/eng/content/download/2726/34069/file/nRF24L01P_Product_Specification_1_0.pdf
+ * date:        2017-12-19
+ * author       https://chisl.io/
+ * file:        sim_check.cpp
+ */
+
+/*
+ * Simulator scenarios: delivery with auto-ack, collisions of packets and
+ * of ACKs, listen-before-talk against a busy channel, retuning during a
+ * transmission and multi byte register access through command().
+ *
+ *   g++ -std=c++11 -I.. sim_check.cpp ../nRF24L01_.cpp -o sim_check && ./sim_check
+ *
+ * Exits with 1 if a check fails.
+ */
+
+#include "nRF24L01_Sim.hpp"
+#include <cstdio>
+
+static int failures = 0;
+
+static void expect(bool ok, const char *what)
+{
+	std::printf("%s: %s\n", ok ? "ok  " : "FAIL", what);
+	if (!ok)
+		failures++;
+}
+
+typedef nRF24L01_Base B;
+
+static const uint8_t PTX = B::CONFIG::EN_CRC::mask | B::CONFIG::CRCO::mask | B::CONFIG::PWR_UP::mask;
+static const uint8_t PRX = PTX | B::CONFIG::PRIM_RX::mask;
+
+static void delivery()
+{
+	nRF24L01_SimAir air;
+	nRF24L01_SimRadio tx(air), rx(air);
+	tx.setCONFIG(PTX);
+	rx.setCONFIG(PRX);
+	rx.setRX_PW_P0(4);
+	rx.ce(true);
+	uint8_t data[4] = { 1, 2, 3, 4 }, got[4] = { 0, 0, 0, 0 };
+	tx.writeTxPayload(data, 4);
+	tx.pulseCe();
+	air.run(10000);
+	expect(tx.getSTATUS() & B::STATUS::TX_DS::mask, "auto-ack packet reaches TX_DS");
+	rx.readRxPayload(got, 4);
+	expect(air.delivered == 1 && std::memcmp(got, data, 4) == 0, "payload delivered once and intact");
+}
+
+static void packetCollision()
+{
+	nRF24L01_SimAir air;
+	nRF24L01_SimRadio a(air), b(air), rx(air);
+	a.setCONFIG(PTX);
+	b.setCONFIG(PTX);
+	rx.setCONFIG(PRX);
+	rx.setRX_PW_P0(4);
+	rx.ce(true);
+	uint8_t data[4] = { 1, 2, 3, 4 };
+	a.writeTxPayload(data, 4);
+	b.writeTxPayload(data, 4);
+	a.pulseCe();
+	b.pulseCe();
+	air.run(100000);
+	expect(air.collisions > 0, "simultaneous packets collide");
+	expect(a.getSTATUS() & B::STATUS::MAX_RT::mask, "senders in lockstep reach MAX_RT");
+}
+
+static void ackCollision()
+{
+	nRF24L01_SimAir air;
+	nRF24L01_SimRadio a(air), b(air), rx(air);
+	a.setCONFIG(PTX);
+	b.setCONFIG(PTX);
+	b.setTX_ADDR(0x1122334455ull);  /* nobody listens, b only occupies the channel */
+	rx.setCONFIG(PRX);
+	rx.setRX_PW_P0(4);
+	rx.ce(true);
+	uint8_t data[4] = { 1, 2, 3, 4 };
+	a.writeTxPayload(data, 4);
+	a.pulseCe();
+	uint64_t end = nRF24L01_SimAir::SETTLE_US + nRF24L01_SimAir::airtime(a, 4);
+	air.run(end);  /* a's packet is delivered, its ACK is about to go on air */
+	b.writeTxPayload(data, 4);
+	b.pulseCe();
+	air.run(end + 1000);
+	expect(air.delivered == 1 && air.collisions > 0, "packet sent during an ACK collides with it");
+	expect((a.getOBSERVE_TX() & B::OBSERVE_TX::ARC_CNT::mask) > 0, "sender of the lost ACK retransmits");
+}
+
+static void listenBeforeTalk()
+{
+	nRF24L01_SimAir air;
+	nRF24L01_SimRadio tx(air), node(air);
+	tx.setCONFIG(PTX);
+	node.setCONFIG(PTX);
+	uint8_t data[B::PAYLOAD_MAX] = { 0 };
+	tx.writeTxPayload(data, B::PAYLOAD_MAX);
+	tx.pulseCe();
+	expect(!node.listenBeforeTalk(2, 3), "LBT reports a channel with a packet on air as busy");
+	air.run(100000);
+	expect(node.listenBeforeTalk(2, 3), "LBT reports an idle channel as clear");
+	node.setCONFIG(PTX | B::CONFIG::PRIM_RX::mask);
+	node.listenBeforeTalk(2, 3);
+	expect(node.getCONFIG() == (PTX | B::CONFIG::PRIM_RX::mask), "LBT leaves a receiver in RX");
+	node.setCONFIG(PTX & ~B::CONFIG::PWR_UP::mask);
+	expect(!node.listenBeforeTalk(2, 3), "LBT refuses a powered down radio");
+}
+
+static void retuneDuringTx()
+{
+	nRF24L01_SimAir air;
+	nRF24L01_SimRadio tx(air), rx(air), probe(air);
+	tx.setCONFIG(PTX);
+	tx.setSETUP_RETR(0);
+	rx.setCONFIG(PRX);
+	rx.setRX_PW_P0(4);
+	rx.ce(true);
+	probe.setCONFIG(PRX);
+	uint8_t data[4] = { 1, 2, 3, 4 };
+	tx.writeTxPayload(data, 4);
+	tx.pulseCe();
+	tx.setRF_CH(40);
+	air.run(10000);
+	expect(air.delivered == 0, "packet retuned mid-air is not delivered");
+	probe.ce(true);
+	air.run(10500);
+	probe.ce(false);
+	expect(!(probe.getRPD() & B::RPD::RPD_::mask), "old channel is free once the retuned packet ends");
+}
+
+static void registerCommand()
+{
+	nRF24L01_SimAir air;
+	nRF24L01_SimRadio radio(air);
+	const uint8_t address[5] = { 0x11, 0x22, 0x33, 0x44, 0x55 };
+	uint8_t back[5] = { 0, 0, 0, 0, 0 };
+	radio.command(B::CMD::W_REGISTER | B::TX_ADDR::__address, address, 0, 5);
+	radio.command(B::CMD::R_REGISTER | B::TX_ADDR::__address, 0, back, 5);
+	expect(radio.getTX_ADDR() == 0x5544332211ull && std::memcmp(back, address, 5) == 0,
+		"5 byte address written and read through command()");
+}
+
+int main()
+{
+	delivery();
+	packetCollision();
+	ackCollision();
+	listenBeforeTalk();
+	retuneDuringTx();
+	registerCommand();
+	return failures ? 1 : 0;
+}
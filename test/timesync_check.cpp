@@ -0,0 +1,104 @@
+/*
+ * name:        nRF24L01+
+ * description: Single Chip 2.4GHz Transceiver
+ * manuf:       Nordic Semiconductor
+ * version:     0.1
+ * url:         https://www.nordicsemi.com/eng/content/download/2726/34069/file/nRF24L01P_Product_Specification_1_0.pdf
+ * date:        2017-12-19
+ * author       https://chisl.io/
+ * file:        timesync_check.cpp
+ */
+
+/*
+ * Time synchronization over the simulator: a node whose clock runs 50 ppm
+ * fast and starts at an arbitrary offset follows the root's beacons every
+ * 100 ms and must agree with the root's global time within 1 us.
+ *
+ *   g++ -std=c++11 -I.. timesync_check.cpp ../nRF24L01_.cpp -o timesync_check && ./timesync_check
+ *
+ * Exits with 1 if a check fails.
+ */
+
+#include "nRF24L01_Sim.hpp"
+#include "nRF24L01_TimeSync.hpp"
+#include <cstdio>
+#include <cstdlib>
+
+static int failures = 0;
+
+static void expect(bool ok, const char *what)
+{
+	std::printf("%s: %s\n", ok ? "ok  " : "FAIL", what);
+	if (!ok)
+		failures++;
+}
+
+typedef nRF24L01_Base B;
+
+/* Radio with a local clock derived from simulated time */
+struct Node : nRF24L01_SimRadio
+{
+	double rate, offset;
+	nRF24L01_TimeSync<8> *sync;
+	uint32_t stamp;
+
+	Node(nRF24L01_SimAir &air, double rate, double offset)
+		: nRF24L01_SimRadio(air), rate(rate), offset(offset), sync(0), stamp(0) {}
+
+	uint32_t local()
+	{
+		return (uint32_t)(uint64_t)(air.now * rate + offset);
+	}
+
+	static void handler(void *context, uint8_t, const uint8_t *data, uint8_t n)
+	{
+		Node *node = static_cast<Node *>(context);
+		node->sync->onBeacon(data, n, node->stamp);
+	}
+
+	void irq()
+	{
+		stamp = local();  /* RX_DR edge */
+		uint8_t width[6] = { 0, 0, 0, 0, 0, 0 };
+		service(handler, this, width);
+	}
+};
+
+static const uint8_t PRX = B::CONFIG::EN_CRC::mask | B::CONFIG::CRCO::mask | B::CONFIG::PWR_UP::mask | B::CONFIG::PRIM_RX::mask;
+
+int main()
+{
+	nRF24L01_SimAir air;
+	Node root(air, 1.0, 1000), node(air, 1.00005, 4000000000.0);
+	Node *nodes[2] = { &root, &node };
+	for (unsigned i = 0; i < 2; i++)
+	{
+		nodes[i]->setCONFIG(PRX);
+		nodes[i]->enableDynamicPayloads(1);
+		nodes[i]->enableBroadcast(0xE7E7E7E7E7ull);
+		nodes[i]->ce(true);
+	}
+	nRF24L01_TimeSync<8> a(root, 1), b(node, 2);
+	root.sync = &a;
+	node.sync = &b;
+
+	int worst = 0;
+	for (unsigned k = 0; k < 40; k++)
+	{
+		root.ce(false);  /* beacon from the root, then back to RX */
+		root.setCONFIG(PRX & ~B::CONFIG::PRIM_RX::mask);
+		a.tick(root.local());
+		air.run(air.now + 2000);
+		root.setCONFIG(PRX);
+		root.setSTATUS(B::STATUS::__clear);
+		root.ce(true);
+		air.run(air.now + 98000);
+		int error = (int)(b.globalTime(node.local()) - a.globalTime(root.local()));
+		if (k >= nRF24L01_TimeSync<8>::ENTRIES_TO_SYNC && std::abs(error) > worst)
+			worst = std::abs(error);
+	}
+	std::printf("worst error %d us\n", worst);
+	expect(b.synchronized() && b.root == 1, "node follows the root");
+	expect(worst <= 1, "global time within 1 us at 50 ppm skew");
+	return failures ? 1 : 0;
+}
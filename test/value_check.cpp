@@ -0,0 +1,85 @@
+/*
+ * name:        nRF24L01+
+ * description: Single Chip 2.4GHz Transceiver
+ * manuf:       Nordic Semiconductor
+ * version:     0.1
+ * url:         https://www.nordicsemi.com/eng/content/download/2726/34069/file/nRF24L01P_Product_Specification_1_0.pdf
+ * date:        2017-12-19
+ * author       https://chisl.io/
+ * file:        value_check.cpp
+ */
+
+/*
+ * nRF24L01_Value and setRegister(): checked values compose as expected,
+ * and each misuse selected with -DFAIL_<case> must not compile.
+ *
+ *   g++ -std=c++11 -I.. value_check.cpp ../nRF24L01_.cpp -o value_check && ./value_check
+ *   for c in FIFO_STATUS RPD OBSERVE_TX FOREIGN_FIELD READONLY_FIELD WIDE_CONSTANT; do
+ *     g++ -std=c++11 -fsyntax-only -I.. -DFAIL_$c value_check.cpp 2>/dev/null && echo "FAIL: $c compiles"
+ *   done
+ *
+ * Exits with 1 if a check fails.
+ */
+
+#include "nRF24L01_.hpp"
+#include <cstdio>
+
+static int failures = 0;
+
+static void expect(bool ok, const char *what)
+{
+	std::printf("%s: %s\n", ok ? "ok  " : "FAIL", what);
+	if (!ok)
+		failures++;
+}
+
+typedef nRF24L01_Base B;
+
+/* Records the last 8 bit write */
+class Recorder : public nRF24L01_Base
+{
+public:
+	Recorder() : address(0xFF), value(0) {}
+
+	uint8_t read8(uint16_t, uint16_t) { return 0; }
+	void write(uint16_t address, uint8_t value, uint16_t) { this->address = address; this->value = value; }
+	uint64_t read64(uint16_t, uint16_t) { return 0; }
+	void write(uint16_t address, uint64_t value, uint16_t) { this->address = address; this->value = value; }
+	uint8_t command(uint8_t, const uint8_t *, uint8_t *, uint16_t) { return 0; }
+
+	uint16_t address;
+	uint64_t value;
+};
+
+int main()
+{
+	Recorder radio;
+	bool on = true;
+	radio.setRegister(nRF24L01_Value<B::CONFIG>()
+		.set<B::CONFIG::EN_CRC, 1>()
+		.set<B::CONFIG::PWR_UP>(on));
+	expect(radio.address == B::CONFIG::__address
+		&& radio.value == (B::CONFIG::EN_CRC::mask | B::CONFIG::PWR_UP::mask), "CONFIG composed from its fields");
+	radio.setRegister(nRF24L01_Value<B::RF_CH>().set<B::RF_CH::RF_CH_>(0x1FF));
+	expect(radio.value == B::RF_CH::RF_CH_::mask, "run time value cut to the field");
+
+#ifdef FAIL_FIFO_STATUS
+	radio.setRegister(nRF24L01_Value<B::FIFO_STATUS>());  /* no writable bits */
+#endif
+#ifdef FAIL_RPD
+	radio.setRegister(nRF24L01_Value<B::RPD>());  /* no writable bits */
+#endif
+#ifdef FAIL_OBSERVE_TX
+	radio.setRegister(nRF24L01_Value<B::OBSERVE_TX>());  /* no writable bits */
+#endif
+#ifdef FAIL_FOREIGN_FIELD
+	nRF24L01_Value<B::CONFIG>().set<B::EN_AA::ENAA_P0, 1>();  /* field of another register */
+#endif
+#ifdef FAIL_READONLY_FIELD
+	nRF24L01_Value<B::FIFO_STATUS>().set<B::FIFO_STATUS::TX_FULL, 1>();  /* read-only field */
+#endif
+#ifdef FAIL_WIDE_CONSTANT
+	nRF24L01_Value<B::SETUP_AW>().set<B::SETUP_AW::AW, 4>();  /* 4 does not fit 2 bits */
+#endif
+	return failures ? 1 : 0;
+}